@@ -0,0 +1,234 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+
+#include <nil/crypto3/algebra/curves/pallas.hpp>
+#include <nil/crypto3/algebra/random_element.hpp>
+#include <nil/crypto3/algebra/type_traits.hpp>
+#include <nil/crypto3/hash/sha2.hpp>
+#include <nil/crypto3/hash/blake2b.hpp>
+#include <nil/crypto3/hash/poseidon.hpp>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/proof.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+using namespace nil::crypto3;
+using namespace nil::crypto3::containers;
+
+using curve_type = algebra::curves::pallas;
+using field_type = typename curve_type::base_field_type;
+using poseidon_type = hashes::poseidon<nil::crypto3::hashes::detail::mina_poseidon_policy<field_type>>;
+
+// Leaf payload per hash: 64 bytes for the block hashes, one field element for Poseidon.
+template<typename Hash, typename = void>
+struct leaf_traits {
+    typedef std::array<std::uint8_t, 64> leaf_type;
+
+    static leaf_type random(std::mt19937_64 &rng) {
+        leaf_type leaf;
+        for (auto &b : leaf) {
+            b = static_cast<std::uint8_t>(rng());
+        }
+        return leaf;
+    }
+};
+
+template<typename Hash>
+struct leaf_traits<Hash, typename std::enable_if<algebra::is_field_element<typename Hash::word_type>::value>::type> {
+    typedef std::array<typename Hash::word_type, 1> leaf_type;
+
+    static leaf_type random(std::mt19937_64 &) {
+        return {algebra::random_element<typename Hash::word_type::field_type>()};
+    }
+};
+
+template<typename Hash>
+std::vector<typename leaf_traits<Hash>::leaf_type> generate_leaves(std::size_t leaf_number) {
+    std::mt19937_64 rng(leaf_number);
+    std::vector<typename leaf_traits<Hash>::leaf_type> v;
+    v.reserve(leaf_number);
+    for (std::size_t i = 0; i < leaf_number; ++i) {
+        v.emplace_back(leaf_traits<Hash>::random(rng));
+    }
+    return v;
+}
+
+template<typename Hash, std::size_t Arity>
+struct tree_fixture {
+    typedef typename leaf_traits<Hash>::leaf_type leaf_type;
+    typedef merkle_tree<Hash, Arity> tree_type;
+    typedef merkle_proof<Hash, Arity> proof_type;
+
+    constexpr static const std::size_t leaf_bytes = sizeof(leaf_type);
+    constexpr static const std::size_t node_bytes = Arity * tree_type::value_bits / 8;
+
+    explicit tree_fixture(std::size_t leaf_number) :
+        leaves(generate_leaves<Hash>(leaf_number)), tree(make_merkle_tree<Hash, Arity>(leaves.begin(), leaves.end())) {
+    }
+
+    // Hash invocations and hashed bytes of one leaf-to-root path.
+    std::size_t path_hashes() const {
+        return tree.row_count();
+    }
+    std::size_t path_bytes() const {
+        return leaf_bytes + (tree.row_count() - 1) * node_bytes;
+    }
+
+    std::vector<leaf_type> leaves;
+    tree_type tree;
+};
+
+// Reports the counters every benchmark here shares: hash invocations and hashed bytes per second.
+inline void set_hash_counters(benchmark::State &state, std::size_t hashes, std::size_t bytes) {
+    state.counters["hashes"] =
+        benchmark::Counter(static_cast<double>(hashes) * state.iterations(), benchmark::Counter::kIsRate);
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes) * state.iterations());
+}
+
+// Number of queried leaves for the compressed proof benchmarks.
+constexpr static const std::size_t compressed_proofs_count = 64;
+
+template<typename Hash, std::size_t Arity>
+void merkle_tree_build(benchmark::State &state) {
+    typedef tree_fixture<Hash, Arity> fixture_type;
+    const std::size_t leaf_number = state.range(0);
+    auto leaves = generate_leaves<Hash>(leaf_number);
+
+    for (auto _ : state) {
+        auto tree = make_merkle_tree<Hash, Arity>(leaves.begin(), leaves.end());
+        benchmark::DoNotOptimize(tree.root());
+    }
+
+    const std::size_t nodes = (leaf_number - 1) / (Arity - 1);
+    set_hash_counters(state, leaf_number + nodes,
+                      leaf_number * fixture_type::leaf_bytes + nodes * fixture_type::node_bytes);
+}
+
+template<typename Hash, std::size_t Arity>
+void merkle_proof_construct(benchmark::State &state) {
+    typedef tree_fixture<Hash, Arity> fixture_type;
+    fixture_type fixture(state.range(0));
+    std::mt19937_64 rng(0);
+
+    for (auto _ : state) {
+        typename fixture_type::proof_type proof(fixture.tree, rng() % fixture.leaves.size());
+        benchmark::DoNotOptimize(proof.root());
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+template<typename Hash, std::size_t Arity>
+void merkle_proof_validate(benchmark::State &state) {
+    typedef tree_fixture<Hash, Arity> fixture_type;
+    fixture_type fixture(state.range(0));
+    const std::size_t leaf_idx = fixture.leaves.size() / 3;
+    typename fixture_type::proof_type proof(fixture.tree, leaf_idx);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(proof.validate(fixture.leaves[leaf_idx]));
+    }
+
+    set_hash_counters(state, fixture.path_hashes(), fixture.path_bytes());
+}
+
+template<typename Hash, std::size_t Arity>
+void merkle_compressed_proofs_generate(benchmark::State &state) {
+    typedef tree_fixture<Hash, Arity> fixture_type;
+    fixture_type fixture(state.range(0));
+    std::mt19937_64 rng(0);
+    std::vector<std::size_t> leaf_idxs(compressed_proofs_count);
+    for (auto &idx : leaf_idxs) {
+        idx = rng() % fixture.leaves.size();
+    }
+
+    for (auto _ : state) {
+        auto proofs = fixture_type::proof_type::generate_compressed_proofs(fixture.tree, leaf_idxs);
+        benchmark::DoNotOptimize(proofs.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * leaf_idxs.size());
+}
+
+template<typename Hash, std::size_t Arity>
+void merkle_compressed_proofs_validate(benchmark::State &state) {
+    typedef tree_fixture<Hash, Arity> fixture_type;
+    fixture_type fixture(state.range(0));
+    std::mt19937_64 rng(0);
+    std::vector<std::size_t> leaf_idxs(compressed_proofs_count);
+    std::vector<typename fixture_type::leaf_type> leaves;
+    for (auto &idx : leaf_idxs) {
+        idx = rng() % fixture.leaves.size();
+        leaves.emplace_back(fixture.leaves[idx]);
+    }
+    auto proofs = fixture_type::proof_type::generate_compressed_proofs(fixture.tree, leaf_idxs);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fixture_type::proof_type::validate_compressed_proofs(proofs, leaves));
+    }
+
+    // Upper bound: shared path prefixes are hashed once, so the real figure is lower.
+    set_hash_counters(state, leaf_idxs.size() * fixture.path_hashes(), leaf_idxs.size() * fixture.path_bytes());
+    state.SetItemsProcessed(state.iterations() * leaf_idxs.size());
+}
+
+// Leaf counts from 2^10 to 2^24, restricted to the powers of 'Arity' a full tree accepts.
+template<std::size_t Arity>
+void leaf_numbers(benchmark::internal::Benchmark *b) {
+    for (std::size_t n = Arity; n <= (std::size_t(1) << 24); n *= Arity) {
+        if (n >= (std::size_t(1) << 10)) {
+            b->Arg(n);
+        }
+    }
+    b->Unit(benchmark::kMillisecond);
+}
+
+#define CONTAINERS_MERKLE_BENCHMARKS(Hash, Arity)                                                   \
+    BENCHMARK_TEMPLATE(merkle_tree_build, Hash, Arity)->Apply(leaf_numbers<Arity>);                 \
+    BENCHMARK_TEMPLATE(merkle_proof_construct, Hash, Arity)->Apply(leaf_numbers<Arity>);            \
+    BENCHMARK_TEMPLATE(merkle_proof_validate, Hash, Arity)->Apply(leaf_numbers<Arity>);             \
+    BENCHMARK_TEMPLATE(merkle_compressed_proofs_generate, Hash, Arity)->Apply(leaf_numbers<Arity>); \
+    BENCHMARK_TEMPLATE(merkle_compressed_proofs_validate, Hash, Arity)->Apply(leaf_numbers<Arity>)
+
+CONTAINERS_MERKLE_BENCHMARKS(hashes::sha2<256>, 2);
+CONTAINERS_MERKLE_BENCHMARKS(hashes::sha2<256>, 4);
+CONTAINERS_MERKLE_BENCHMARKS(hashes::sha2<256>, 8);
+CONTAINERS_MERKLE_BENCHMARKS(hashes::blake2b<224>, 2);
+CONTAINERS_MERKLE_BENCHMARKS(hashes::blake2b<224>, 4);
+CONTAINERS_MERKLE_BENCHMARKS(hashes::blake2b<224>, 8);
+CONTAINERS_MERKLE_BENCHMARKS(poseidon_type, 2);
+CONTAINERS_MERKLE_BENCHMARKS(poseidon_type, 4);
+CONTAINERS_MERKLE_BENCHMARKS(poseidon_type, 8);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,66 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+
+#include <nil/crypto3/algebra/curves/pallas.hpp>
+#include <nil/crypto3/algebra/random_element.hpp>
+
+#include <nil/crypto3/container/sparse_vector.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+using namespace nil::crypto3;
+
+using curve_type = algebra::curves::pallas;
+using group_type = typename curve_type::template g1_type<>;
+using scalar_field_type = typename curve_type::scalar_field_type;
+
+// Accumulates a dense window of 'range(0)' scalars into a sparse vector of the same length,
+// i.e. one multiexp over the whole vector.
+void sparse_vector_insert(benchmark::State &state) {
+    const std::size_t size = state.range(0);
+
+    std::vector<typename group_type::value_type> bases(size);
+    std::vector<typename scalar_field_type::value_type> scalars(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        bases[i] = algebra::random_element<group_type>();
+        scalars[i] = algebra::random_element<scalar_field_type>();
+    }
+    const container::sparse_vector<group_type> v(std::move(bases));
+
+    for (auto _ : state) {
+        auto result = v.insert(0, scalars.cbegin(), scalars.cend());
+        benchmark::DoNotOptimize(result.first);
+    }
+
+    state.SetItemsProcessed(state.iterations() * size);
+    state.SetBytesProcessed(state.iterations() * size * (group_type::value_bits + scalar_field_type::value_bits) / 8);
+}
+
+BENCHMARK(sparse_vector_insert)->RangeMultiplier(4)->Range(1 << 10, 1 << 16)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
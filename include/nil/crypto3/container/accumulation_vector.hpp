@@ -29,6 +29,8 @@
 
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <vector>
 
 #include <nil/crypto3/container/sparse_vector.hpp>
 
@@ -41,33 +43,38 @@ namespace nil {
              * The method "accumulate_chunk" allows one to accumulate portions of the sparse
              * vector into the accumulation value.
              */
-            template<typename Type>
+            template<typename Type, typename Allocator = std::allocator<typename Type::value_type>>
             class accumulation_vector {
                 using underlying_value_type = typename Type::value_type;
 
+                typedef typename std::allocator_traits<Allocator>::template rebind_alloc<underlying_value_type>
+                    value_allocator_type;
+                typedef std::vector<underlying_value_type, value_allocator_type> value_container_type;
+
             public:
                 using group_type = Type;
 
                 underlying_value_type first;
-                sparse_vector<Type> rest;
+                sparse_vector<Type, Allocator> rest;
 
                 accumulation_vector() = default;
-                accumulation_vector(const accumulation_vector<Type> &other) = default;
-                accumulation_vector(accumulation_vector<Type> &&other) = default;
-                accumulation_vector(const underlying_value_type &first, sparse_vector<Type> &&rest) :
+                accumulation_vector(const accumulation_vector<Type, Allocator> &other) = default;
+                accumulation_vector(accumulation_vector<Type, Allocator> &&other) = default;
+                accumulation_vector(const underlying_value_type &first, sparse_vector<Type, Allocator> &&rest) :
                     first(first), rest(std::move(rest)) {};
-                accumulation_vector(underlying_value_type &&first, sparse_vector<Type> &&rest) :
+                accumulation_vector(underlying_value_type &&first, sparse_vector<Type, Allocator> &&rest) :
                     first(std::move(first)), rest(std::move(rest)) {};
-                accumulation_vector(underlying_value_type &&first, std::vector<underlying_value_type> &&v) :
+                accumulation_vector(underlying_value_type &&first, value_container_type &&v) :
                     first(std::move(first)), rest(std::move(v)) {
                 }
-                accumulation_vector(std::vector<underlying_value_type> &&v) :
+                accumulation_vector(value_container_type &&v) :
                     first(underlying_value_type::zero()), rest(std::move(v)) {};
 
-                accumulation_vector<Type> &operator=(const accumulation_vector<Type> &other) = default;
-                accumulation_vector<Type> &operator=(accumulation_vector<Type> &&other) = default;
+                accumulation_vector<Type, Allocator> &
+                    operator=(const accumulation_vector<Type, Allocator> &other) = default;
+                accumulation_vector<Type, Allocator> &operator=(accumulation_vector<Type, Allocator> &&other) = default;
 
-                bool operator==(const accumulation_vector<Type> &other) const {
+                bool operator==(const accumulation_vector<Type, Allocator> &other) const {
                     return (this->first == other.first && this->rest == other.rest);
                 }
 
@@ -89,12 +96,27 @@ namespace nil {
                     return first_size_in_bits + rest_size_in_bits;
                 }
 
-                template<typename InputIterator>
-                accumulation_vector<Type> accumulate_chunk(InputIterator begin, InputIterator end,
-                                                           std::size_t offset) const {
-                    std::pair<underlying_value_type, sparse_vector<Type>> acc_result = rest.insert(offset, begin, end);
+                // See sparse_vector::insert for MultiexpMethod and threads.
+                template<typename MultiexpMethod = algebra::policies::multiexp_method_bos_coster,
+                         typename InputIterator>
+                accumulation_vector<Type, Allocator> accumulate_chunk(InputIterator begin, InputIterator end,
+                                                                      std::size_t offset,
+                                                                      std::size_t threads = 1) const {
+                    std::pair<underlying_value_type, sparse_vector<Type, Allocator>> acc_result =
+                        rest.template insert<MultiexpMethod>(offset, begin, end, threads);
                     underlying_value_type new_first = first + acc_result.first;
-                    return accumulation_vector<Type>(std::move(new_first), std::move(acc_result.second));
+                    return accumulation_vector<Type, Allocator>(std::move(new_first), std::move(acc_result.second));
+                }
+
+                // Same as accumulate_chunk, but accumulates into this vector: the accumulated entries are
+                // removed from 'rest' in place, so streaming K chunks never copies the remaining ones.
+                template<typename MultiexpMethod = algebra::policies::multiexp_method_bos_coster,
+                         typename InputIterator>
+                accumulation_vector<Type, Allocator> &accumulate_chunk_inplace(InputIterator begin, InputIterator end,
+                                                                               std::size_t offset,
+                                                                               std::size_t threads = 1) {
+                    first = first + rest.template insert_inplace<MultiexpMethod>(offset, begin, end, threads);
+                    return *this;
                 }
             };
         }    // namespace container
@@ -0,0 +1,282 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2021 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2020-2021 Nikita Kaskov <nbering@nil.foundation>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+// @file Declaration of interfaces for a sparse vector with run-length compressed indices.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_ZK_COMPRESSED_SPARSE_VECTOR_HPP
+#define CRYPTO3_ZK_COMPRESSED_SPARSE_VECTOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <nil/crypto3/container/sparse_vector.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace container {
+
+            /**
+             * A sparse vector storing its indices as runs of consecutive indices, in IndexType.
+             *
+             * Run r covers the indices [run_starts[r], run_starts[r] + run_length(r)) and its values are
+             * values[run_offsets[r]], ..., values[run_offsets[r + 1] - 1], so a dense range costs two indices
+             * however long it is and a lookup is a binary search over the runs, O(1) within a dense vector.
+             * Runs are kept maximal: two runs are never adjacent.
+             */
+            template<typename Type, typename IndexType = std::uint32_t>
+            class compressed_sparse_vector {
+                using underlying_value_type = typename Type::value_type;
+
+            public:
+                using group_type = Type;
+
+                typedef IndexType index_type;
+                typedef underlying_value_type value_type;
+                typedef std::size_t size_type;
+
+                std::vector<index_type> run_starts;
+                std::vector<index_type> run_offsets;
+                std::vector<underlying_value_type> values;
+                std::size_t domain_size_;
+
+                compressed_sparse_vector() : run_offsets(1, 0), domain_size_(0) {
+                }
+
+                compressed_sparse_vector(const compressed_sparse_vector &other) = default;
+                compressed_sparse_vector(compressed_sparse_vector &&other) = default;
+
+                explicit compressed_sparse_vector(sparse_vector<Type> v) :
+                    run_offsets(1, 0), values(std::move(v.values)), domain_size_(v.domain_size_) {
+                    if (domain_size_ > std::numeric_limits<index_type>::max()) {
+                        throw std::length_error("Domain size does not fit the index type");
+                    }
+                    for (std::size_t i = 0; i < v.indices.size(); ++i) {
+                        if (i == 0 || v.indices[i] != v.indices[i - 1] + 1) {
+                            if (i != 0) {
+                                run_offsets.emplace_back(i);
+                            }
+                            run_starts.emplace_back(v.indices[i]);
+                        }
+                    }
+                    if (!run_starts.empty()) {
+                        run_offsets.emplace_back(values.size());
+                    }
+                }
+
+                compressed_sparse_vector &operator=(const compressed_sparse_vector &other) = default;
+                compressed_sparse_vector &operator=(compressed_sparse_vector &&other) = default;
+
+                sparse_vector<Type> decompress() const {
+                    sparse_vector<Type> result;
+                    result.domain_size_ = domain_size_;
+                    result.indices.reserve(values.size());
+                    for (std::size_t r = 0; r < runs(); ++r) {
+                        for (std::size_t i = 0; i < run_length(r); ++i) {
+                            result.indices.emplace_back(run_starts[r] + i);
+                        }
+                    }
+                    result.values = values;
+                    return result;
+                }
+
+                underlying_value_type operator[](const std::size_t idx) const {
+                    auto it = std::upper_bound(run_starts.begin(), run_starts.end(), idx);
+                    if (it == run_starts.begin()) {
+                        return underlying_value_type();
+                    }
+                    const std::size_t r = it - run_starts.begin() - 1;
+                    return idx - run_starts[r] < run_length(r) ? values[run_offsets[r] + idx - run_starts[r]] :
+                                                                 underlying_value_type();
+                }
+
+                // Structural equality, runs being maximal both sides store the same entries the same way.
+                bool operator==(const compressed_sparse_vector &other) const {
+                    return domain_size_ == other.domain_size_ && run_starts == other.run_starts &&
+                           run_offsets == other.run_offsets && values == other.values;
+                }
+                bool operator!=(const compressed_sparse_vector &other) const {
+                    return !(*this == other);
+                }
+
+                bool is_valid() const {
+                    if (run_offsets.size() != runs() + 1 || run_offsets.front() != 0 ||
+                        run_offsets.back() != values.size()) {
+                        return false;
+                    }
+                    for (std::size_t r = 0; r < runs(); ++r) {
+                        if (run_length(r) == 0 ||
+                            (r + 1 < runs() && run_starts[r] + run_length(r) >= run_starts[r + 1])) {
+                            return false;
+                        }
+                    }
+                    return runs() == 0 || run_starts.back() + run_length(runs() - 1) <= domain_size_;
+                }
+
+                bool empty() const {
+                    return values.empty();
+                }
+
+                std::size_t domain_size() const {
+                    return domain_size_;
+                }
+
+                std::size_t size() const {
+                    return values.size();
+                }
+
+                std::size_t runs() const {
+                    return run_starts.size();
+                }
+
+                std::size_t run_length(std::size_t r) const {
+                    return run_offsets[r + 1] - run_offsets[r];
+                }
+
+                std::size_t size_in_bits() const {
+                    return (run_starts.size() + run_offsets.size()) * sizeof(index_type) * 8 +
+                           values.size() * Type::value_bits;
+                }
+
+                /* return a pair consisting of the accumulated value and the sparse vector of non-accumulated values,
+                 * see sparse_vector::insert
+                 */
+                template<typename MultiexpMethod = algebra::policies::multiexp_method_bos_coster,
+                         typename InputBaseIterator>
+                std::pair<underlying_value_type, compressed_sparse_vector>
+                    insert(std::size_t offset, InputBaseIterator first, InputBaseIterator last,
+                           std::size_t threads = 1) const {
+                    CRYPTO3_CONTAINERS_TIME_SCOPE(sparse_vector_insert);
+
+                    compressed_sparse_vector resulting_vector;
+                    resulting_vector.domain_size_ = domain_size_;
+                    std::vector<detail::multiexp_piece> pieces;
+                    std::pair<std::size_t, std::size_t> removed =
+                        split(offset, std::distance(first, last), threads, pieces, resulting_vector);
+
+                    CRYPTO3_CONTAINERS_COUNT(allocation, values.size() != removed.second - removed.first ? 1 : 0);
+                    resulting_vector.values.reserve(values.size() - (removed.second - removed.first));
+                    resulting_vector.values.insert(resulting_vector.values.end(), values.begin(),
+                                                   values.begin() + removed.first);
+                    resulting_vector.values.insert(resulting_vector.values.end(), values.begin() + removed.second,
+                                                   values.end());
+
+                    return std::make_pair(
+                        detail::accumulate_multiexp_pieces<MultiexpMethod>(pieces, values.begin(), first, threads),
+                        std::move(resulting_vector));
+                }
+
+                /* same as insert, but removes the accumulated entries from this vector in place and only
+                 * returns the accumulated value
+                 */
+                template<typename MultiexpMethod = algebra::policies::multiexp_method_bos_coster,
+                         typename InputBaseIterator>
+                underlying_value_type insert_inplace(std::size_t offset, InputBaseIterator first,
+                                                     InputBaseIterator last, std::size_t threads = 1) {
+                    CRYPTO3_CONTAINERS_TIME_SCOPE(sparse_vector_insert);
+
+                    compressed_sparse_vector runs_left;
+                    std::vector<detail::multiexp_piece> pieces;
+                    std::pair<std::size_t, std::size_t> removed =
+                        split(offset, std::distance(first, last), threads, pieces, runs_left);
+
+                    const underlying_value_type accumulated_value =
+                        detail::accumulate_multiexp_pieces<MultiexpMethod>(pieces, values.begin(), first, threads);
+                    values.erase(values.begin() + removed.first, values.begin() + removed.second);
+                    run_starts.swap(runs_left.run_starts);
+                    run_offsets.swap(runs_left.run_offsets);
+                    return accumulated_value;
+                }
+
+            private:
+                // Cuts the entries with indices in [offset, offset + range_len) into multiexp 'pieces' and
+                // writes the runs left over to 'rest'. Returns the positions [first, second) of the
+                // accumulated values, which are contiguous.
+                std::pair<std::size_t, std::size_t> split(std::size_t offset, std::size_t range_len,
+                                                          std::size_t threads,
+                                                          std::vector<detail::multiexp_piece> &pieces,
+                                                          compressed_sparse_vector &rest) const {
+                    const std::size_t window_last = offset + range_len;
+                    std::size_t removed_first = values.size(), removed_last = values.size();
+
+                    // runs [r_first, r_last) intersect the window
+                    std::size_t r_first =
+                        std::upper_bound(run_starts.begin(), run_starts.end(), offset) - run_starts.begin();
+                    if (r_first != 0 && run_starts[r_first - 1] + run_length(r_first - 1) > offset) {
+                        --r_first;
+                    }
+                    const std::size_t r_last =
+                        range_len == 0 ? r_first :
+                                         std::lower_bound(run_starts.begin() + r_first, run_starts.end(), window_last) -
+                                             run_starts.begin();
+
+                    std::size_t terms = 0;
+                    for (std::size_t r = r_first; r < r_last; ++r) {
+                        terms += std::min<std::size_t>(run_starts[r] + run_length(r), window_last) -
+                                 std::max<std::size_t>(run_starts[r], offset);
+                    }
+                    const std::size_t grain = detail::multiexp_piece_grain(terms, threads);
+
+                    rest.run_starts.reserve(runs() + 1);
+                    rest.run_offsets.reserve(runs() + 2);
+                    std::size_t removed = 0;
+                    // the values kept follow each other, so a kept run only adds its end offset
+                    auto keep = [&](std::size_t start, std::size_t value_last) {
+                        rest.run_starts.emplace_back(start);
+                        rest.run_offsets.emplace_back(value_last - removed);
+                    };
+                    for (std::size_t r = 0; r < runs(); ++r) {
+                        const std::size_t start = run_starts[r], end = start + run_length(r), o = run_offsets[r];
+                        if (r < r_first || r >= r_last) {
+                            keep(start, o + (end - start));
+                            continue;
+                        }
+                        const std::size_t lo = std::max(start, offset), hi = std::min(end, window_last);
+                        if (lo > start) {
+                            keep(start, o + (lo - start));
+                        }
+                        if (r == r_first) {
+                            removed_first = o + (lo - start);
+                        }
+                        detail::append_multiexp_pieces(pieces, o + (lo - start), o + (hi - start), lo - offset,
+                                                       grain);
+                        removed += hi - lo;
+                        removed_last = o + (hi - start);
+                        if (end > hi) {
+                            keep(hi, o + (end - start));
+                        }
+                    }
+                    return std::make_pair(removed_first, removed_last);
+                }
+            };
+        }    // namespace container
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_ZK_COMPRESSED_SPARSE_VECTOR_HPP
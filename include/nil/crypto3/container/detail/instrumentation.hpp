@@ -0,0 +1,177 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+
+#ifndef CRYPTO3_CONTAINER_DETAIL_INSTRUMENTATION_HPP
+#define CRYPTO3_CONTAINER_DETAIL_INSTRUMENTATION_HPP
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#ifdef CRYPTO3_CONTAINERS_INSTRUMENTATION
+#include <atomic>
+#include <chrono>
+#endif
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            // Events counted by the hot paths (tree builds, node hashing, proof validation and
+            // sparse_vector::insert) when CRYPTO3_CONTAINERS_INSTRUMENTATION is defined. Without it
+            // the hooks expand to nothing and every counter reads zero.
+            enum class instrumentation_event : std::size_t {
+                hash_invocation,
+                accumulator_construction,
+                allocation,
+                tree_build,
+                proof_validation,
+                sparse_vector_insert,
+                count
+            };
+
+            // Snapshot of the global counters. Timings are the total wall time, in nanoseconds,
+            // spent inside the timed operations; nested and concurrent calls are all added up.
+            struct instrumentation_counters {
+                std::uint64_t hash_invocations = 0;
+                std::uint64_t accumulator_constructions = 0;
+                std::uint64_t allocations = 0;
+                std::uint64_t tree_builds = 0;
+                std::uint64_t tree_build_ns = 0;
+                std::uint64_t proof_validations = 0;
+                std::uint64_t proof_validation_ns = 0;
+                std::uint64_t sparse_vector_inserts = 0;
+                std::uint64_t sparse_vector_insert_ns = 0;
+            };
+
+            namespace detail {
+#ifdef CRYPTO3_CONTAINERS_INSTRUMENTATION
+                constexpr static const std::size_t instrumentation_event_count =
+                    static_cast<std::size_t>(instrumentation_event::count);
+
+                struct instrumentation_state {
+                    std::array<std::atomic<std::uint64_t>, instrumentation_event_count> counts;
+                    std::array<std::atomic<std::uint64_t>, instrumentation_event_count> nanoseconds;
+                };
+
+                inline instrumentation_state &instrumentation() {
+                    static instrumentation_state state {};
+                    return state;
+                }
+
+                inline void instrumentation_count(instrumentation_event e, std::uint64_t n) {
+                    instrumentation().counts[static_cast<std::size_t>(e)].fetch_add(n, std::memory_order_relaxed);
+                }
+
+                // Counts one 'e' and adds the lifetime of the object to its timing.
+                class instrumentation_timer {
+                public:
+                    explicit instrumentation_timer(instrumentation_event e) :
+                        _event(e), _start(std::chrono::steady_clock::now()) {
+                    }
+
+                    instrumentation_timer(const instrumentation_timer &) = delete;
+                    instrumentation_timer &operator=(const instrumentation_timer &) = delete;
+
+                    ~instrumentation_timer() {
+                        const std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                     std::chrono::steady_clock::now() - _start)
+                                                     .count();
+                        instrumentation_count(_event, 1);
+                        instrumentation()
+                            .nanoseconds[static_cast<std::size_t>(_event)]
+                            .fetch_add(ns, std::memory_order_relaxed);
+                    }
+
+                private:
+                    instrumentation_event _event;
+                    std::chrono::steady_clock::time_point _start;
+                };
+#endif
+
+                // Appends to 'c', counting an allocation when that had to grow it.
+                template<typename Container, typename... Args>
+                void instrumented_emplace_back(Container &c, Args &&...args) {
+#ifdef CRYPTO3_CONTAINERS_INSTRUMENTATION
+                    const std::size_t capacity = c.capacity();
+                    c.emplace_back(std::forward<Args>(args)...);
+                    if (c.capacity() != capacity) {
+                        instrumentation_count(instrumentation_event::allocation, 1);
+                    }
+#else
+                    c.emplace_back(std::forward<Args>(args)...);
+#endif
+                }
+            }    // namespace detail
+
+            inline instrumentation_counters instrumentation_snapshot() {
+                instrumentation_counters result;
+#ifdef CRYPTO3_CONTAINERS_INSTRUMENTATION
+                const detail::instrumentation_state &state = detail::instrumentation();
+                auto count = [&state](instrumentation_event e) {
+                    return state.counts[static_cast<std::size_t>(e)].load(std::memory_order_relaxed);
+                };
+                auto ns = [&state](instrumentation_event e) {
+                    return state.nanoseconds[static_cast<std::size_t>(e)].load(std::memory_order_relaxed);
+                };
+                result.hash_invocations = count(instrumentation_event::hash_invocation);
+                result.accumulator_constructions = count(instrumentation_event::accumulator_construction);
+                result.allocations = count(instrumentation_event::allocation);
+                result.tree_builds = count(instrumentation_event::tree_build);
+                result.tree_build_ns = ns(instrumentation_event::tree_build);
+                result.proof_validations = count(instrumentation_event::proof_validation);
+                result.proof_validation_ns = ns(instrumentation_event::proof_validation);
+                result.sparse_vector_inserts = count(instrumentation_event::sparse_vector_insert);
+                result.sparse_vector_insert_ns = ns(instrumentation_event::sparse_vector_insert);
+#endif
+                return result;
+            }
+
+            inline void reset_instrumentation() {
+#ifdef CRYPTO3_CONTAINERS_INSTRUMENTATION
+                detail::instrumentation_state &state = detail::instrumentation();
+                for (std::size_t i = 0; i < detail::instrumentation_event_count; ++i) {
+                    state.counts[i].store(0, std::memory_order_relaxed);
+                    state.nanoseconds[i].store(0, std::memory_order_relaxed);
+                }
+#endif
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+// Hooks used by the hot paths. The arguments are not evaluated unless instrumentation is enabled.
+#ifdef CRYPTO3_CONTAINERS_INSTRUMENTATION
+#define CRYPTO3_CONTAINERS_COUNT(event, n) \
+    ::nil::crypto3::containers::detail::instrumentation_count(::nil::crypto3::containers::instrumentation_event::event, (n))
+#define CRYPTO3_CONTAINERS_TIME_SCOPE(event)                                   \
+    const ::nil::crypto3::containers::detail::instrumentation_timer             \
+        crypto3_containers_instrumentation_timer_##event(                       \
+            ::nil::crypto3::containers::instrumentation_event::event)
+#else
+#define CRYPTO3_CONTAINERS_COUNT(event, n) ((void)0)
+#define CRYPTO3_CONTAINERS_TIME_SCOPE(event) ((void)0)
+#endif
+
+#endif    // CRYPTO3_CONTAINER_DETAIL_INSTRUMENTATION_HPP
@@ -0,0 +1,80 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_CONTAINER_DETAIL_PARALLELIZATION_HPP
+#define CRYPTO3_CONTAINER_DETAIL_PARALLELIZATION_HPP
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Number of worker threads used when the caller does not specify one.
+                inline std::size_t default_thread_count() {
+                    std::size_t n = std::thread::hardware_concurrency();
+                    return n == 0 ? 1 : n;
+                }
+
+                // Splits [begin, end) into at most 'threads' contiguous blocks of nearly equal
+                // size and calls f(block_begin, block_end) for each of them. The calling thread
+                // processes the last block itself, all the others are joined before returning,
+                // so every write made by 'f' is visible to the caller afterwards.
+                template<typename Function>
+                void parallel_for(std::size_t begin, std::size_t end, std::size_t threads, Function f) {
+                    if (begin >= end) {
+                        return;
+                    }
+
+                    const std::size_t n = end - begin;
+                    threads = std::max<std::size_t>(1, std::min(threads, n));
+                    if (threads == 1) {
+                        f(begin, end);
+                        return;
+                    }
+
+                    const std::size_t block = n / threads, remainder = n % threads;
+                    std::vector<std::thread> workers;
+                    workers.reserve(threads - 1);
+
+                    std::size_t block_begin = begin;
+                    for (std::size_t i = 0; i < threads - 1; ++i) {
+                        std::size_t block_end = block_begin + block + (i < remainder ? 1 : 0);
+                        workers.emplace_back(f, block_begin, block_end);
+                        block_begin = block_end;
+                    }
+                    f(block_begin, end);
+
+                    for (auto &worker : workers) {
+                        worker.join();
+                    }
+                }
+            }    // namespace detail
+        }        // namespace containers
+    }            // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_CONTAINER_DETAIL_PARALLELIZATION_HPP
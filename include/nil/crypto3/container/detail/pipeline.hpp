@@ -0,0 +1,185 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+
+#ifndef CRYPTO3_CONTAINER_DETAIL_PIPELINE_HPP
+#define CRYPTO3_CONTAINER_DETAIL_PIPELINE_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Runs consume(transform(x)) for every x of the single-pass range [first, last), in order,
+                // as a three-stage pipeline.
+                //
+                // A reader thread copies the input into chunks of up to 'chunk_size' elements held in a
+                // ring of 'slots' buffers, 'threads' workers transform whole chunks, and the calling thread
+                // consumes the results chunk by chunk in input order and hands the buffers back to the
+                // reader. Reading thus overlaps with transforming, at most 'slots' chunks are in memory,
+                // and the run takes about as long as the slower of the two stages, not their sum.
+                // An exception thrown by any stage stops the others and is rethrown to the caller.
+                template<typename InputIterator, typename Transform, typename Consume>
+                void pipelined_transform(InputIterator first, InputIterator last, std::size_t chunk_size,
+                                         std::size_t slots, std::size_t threads, Transform transform,
+                                         Consume consume) {
+                    typedef typename std::iterator_traits<InputIterator>::value_type input_type;
+                    typedef typename std::decay<decltype(transform(std::declval<const input_type &>()))>::type
+                        output_type;
+
+                    enum class slot_state { empty, read, transformed };
+                    struct slot_type {
+                        std::vector<input_type> input;
+                        std::vector<output_type> output;
+                        slot_state state = slot_state::empty;
+                    };
+
+                    chunk_size = std::max<std::size_t>(1, chunk_size);
+                    threads = std::max<std::size_t>(1, threads);
+                    // Chunk i always goes to ring[i % slots].
+                    std::vector<slot_type> ring(std::max<std::size_t>(1, slots));
+
+                    std::mutex mutex;
+                    std::condition_variable cv;
+                    std::size_t chunks_read = 0, chunks_taken = 0;
+                    bool input_done = false;
+                    std::exception_ptr error;
+
+                    auto fail = [&](std::exception_ptr e) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (!error) {
+                            error = e;
+                        }
+                        cv.notify_all();
+                    };
+
+                    auto reader = [&]() {
+                        try {
+                            while (first != last) {
+                                slot_type *slot;
+                                {
+                                    std::unique_lock<std::mutex> lock(mutex);
+                                    slot = &ring[chunks_read % ring.size()];
+                                    cv.wait(lock, [&]() { return error || slot->state == slot_state::empty; });
+                                    if (error) {
+                                        return;
+                                    }
+                                }
+                                slot->input.clear();
+                                for (; slot->input.size() < chunk_size && first != last; ++first) {
+                                    slot->input.emplace_back(*first);
+                                }
+                                std::lock_guard<std::mutex> lock(mutex);
+                                slot->state = slot_state::read;
+                                ++chunks_read;
+                                cv.notify_all();
+                            }
+                            std::lock_guard<std::mutex> lock(mutex);
+                            input_done = true;
+                            cv.notify_all();
+                        } catch (...) {
+                            fail(std::current_exception());
+                        }
+                    };
+
+                    auto worker = [&]() {
+                        try {
+                            for (;;) {
+                                slot_type *slot;
+                                {
+                                    std::unique_lock<std::mutex> lock(mutex);
+                                    cv.wait(lock,
+                                            [&]() { return error || chunks_taken < chunks_read || input_done; });
+                                    if (error || chunks_taken == chunks_read) {
+                                        return;
+                                    }
+                                    slot = &ring[chunks_taken++ % ring.size()];
+                                }
+                                slot->output.clear();
+                                slot->output.reserve(slot->input.size());
+                                for (const input_type &x : slot->input) {
+                                    slot->output.emplace_back(transform(x));
+                                }
+                                std::lock_guard<std::mutex> lock(mutex);
+                                slot->state = slot_state::transformed;
+                                cv.notify_all();
+                            }
+                        } catch (...) {
+                            fail(std::current_exception());
+                        }
+                    };
+
+                    std::vector<std::thread> stages;
+                    stages.reserve(threads + 1);
+                    stages.emplace_back(reader);
+                    for (std::size_t i = 0; i < threads; ++i) {
+                        stages.emplace_back(worker);
+                    }
+
+                    try {
+                        for (std::size_t chunk = 0;; ++chunk) {
+                            slot_type &slot = ring[chunk % ring.size()];
+                            {
+                                std::unique_lock<std::mutex> lock(mutex);
+                                cv.wait(lock, [&]() {
+                                    return error || slot.state == slot_state::transformed ||
+                                           (input_done && chunk == chunks_read);
+                                });
+                                if (error || slot.state != slot_state::transformed) {
+                                    break;
+                                }
+                            }
+                            for (const output_type &y : slot.output) {
+                                consume(y);
+                            }
+                            std::lock_guard<std::mutex> lock(mutex);
+                            slot.state = slot_state::empty;
+                            cv.notify_all();
+                        }
+                    } catch (...) {
+                        fail(std::current_exception());
+                    }
+
+                    for (std::thread &stage : stages) {
+                        stage.join();
+                    }
+                    if (error) {
+                        std::rethrow_exception(error);
+                    }
+                }
+            }    // namespace detail
+        }        // namespace containers
+    }            // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_CONTAINER_DETAIL_PIPELINE_HPP
@@ -0,0 +1,296 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+// @file Multi-lane SHA-256 over independent messages of the same, fixed length.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_CONTAINER_DETAIL_SHA256_LANES_HPP
+#define CRYPTO3_CONTAINER_DETAIL_SHA256_LANES_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Lane policies: 'width' independent 32-bit words processed by one instruction.
+                struct scalar_lanes {
+                    typedef std::uint32_t word_type;
+                    constexpr static const std::size_t width = 1;
+
+                    static word_type set1(std::uint32_t x) {
+                        return x;
+                    }
+                    static word_type load(const std::uint32_t *p) {
+                        return *p;
+                    }
+                    static void store(std::uint32_t *p, word_type x) {
+                        *p = x;
+                    }
+                    static word_type add(word_type a, word_type b) {
+                        return a + b;
+                    }
+                    static word_type bxor(word_type a, word_type b) {
+                        return a ^ b;
+                    }
+                    static word_type band(word_type a, word_type b) {
+                        return a & b;
+                    }
+                    // ~a & b
+                    static word_type bandnot(word_type a, word_type b) {
+                        return ~a & b;
+                    }
+                    template<int N>
+                    static word_type rotr(word_type x) {
+                        return (x >> N) | (x << (32 - N));
+                    }
+                    template<int N>
+                    static word_type shr(word_type x) {
+                        return x >> N;
+                    }
+                };
+
+#if defined(__SSE2__)
+                struct sse2_lanes {
+                    typedef __m128i word_type;
+                    constexpr static const std::size_t width = 4;
+
+                    static word_type set1(std::uint32_t x) {
+                        return _mm_set1_epi32(static_cast<int>(x));
+                    }
+                    static word_type load(const std::uint32_t *p) {
+                        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                    }
+                    static void store(std::uint32_t *p, word_type x) {
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), x);
+                    }
+                    static word_type add(word_type a, word_type b) {
+                        return _mm_add_epi32(a, b);
+                    }
+                    static word_type bxor(word_type a, word_type b) {
+                        return _mm_xor_si128(a, b);
+                    }
+                    static word_type band(word_type a, word_type b) {
+                        return _mm_and_si128(a, b);
+                    }
+                    static word_type bandnot(word_type a, word_type b) {
+                        return _mm_andnot_si128(a, b);
+                    }
+                    template<int N>
+                    static word_type rotr(word_type x) {
+                        return _mm_or_si128(_mm_srli_epi32(x, N), _mm_slli_epi32(x, 32 - N));
+                    }
+                    template<int N>
+                    static word_type shr(word_type x) {
+                        return _mm_srli_epi32(x, N);
+                    }
+                };
+#endif
+
+#if defined(__AVX2__)
+                struct avx2_lanes {
+                    typedef __m256i word_type;
+                    constexpr static const std::size_t width = 8;
+
+                    static word_type set1(std::uint32_t x) {
+                        return _mm256_set1_epi32(static_cast<int>(x));
+                    }
+                    static word_type load(const std::uint32_t *p) {
+                        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                    }
+                    static void store(std::uint32_t *p, word_type x) {
+                        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), x);
+                    }
+                    static word_type add(word_type a, word_type b) {
+                        return _mm256_add_epi32(a, b);
+                    }
+                    static word_type bxor(word_type a, word_type b) {
+                        return _mm256_xor_si256(a, b);
+                    }
+                    static word_type band(word_type a, word_type b) {
+                        return _mm256_and_si256(a, b);
+                    }
+                    static word_type bandnot(word_type a, word_type b) {
+                        return _mm256_andnot_si256(a, b);
+                    }
+                    template<int N>
+                    static word_type rotr(word_type x) {
+                        return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+                    }
+                    template<int N>
+                    static word_type shr(word_type x) {
+                        return _mm256_srli_epi32(x, N);
+                    }
+                };
+
+                typedef avx2_lanes native_lanes;
+#elif defined(__SSE2__)
+                typedef sse2_lanes native_lanes;
+#else
+                typedef scalar_lanes native_lanes;
+#endif
+
+                // SHA-256 of Lanes::width independent messages, each exactly MessageBytes long,
+                // computed in lockstep: lane 'l' of every vector word belongs to message 'l'.
+                template<typename Lanes, std::size_t MessageBytes>
+                struct sha256_lanes {
+                    typedef Lanes lanes_type;
+                    typedef typename lanes_type::word_type word_type;
+
+                    constexpr static const std::size_t width = lanes_type::width;
+                    constexpr static const std::size_t digest_bytes = 32;
+                    constexpr static const std::size_t block_bytes = 64;
+                    // The message, the 0x80 terminator and the 64-bit length rounded up to blocks.
+                    constexpr static const std::size_t padded_bytes =
+                        ((MessageBytes + 9 + block_bytes - 1) / block_bytes) * block_bytes;
+
+                    static void process(const std::uint8_t *const *messages, std::uint8_t *const *digests) {
+                        static const std::uint32_t initial_state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                                                       0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                                                       0x1f83d9ab, 0x5be0cd19};
+
+                        std::array<std::array<std::uint8_t, padded_bytes>, width> padded;
+                        for (std::size_t l = 0; l < width; ++l) {
+                            pad(messages[l], padded[l].data());
+                        }
+
+                        word_type state[8];
+                        for (std::size_t i = 0; i < 8; ++i) {
+                            state[i] = lanes_type::set1(initial_state[i]);
+                        }
+
+                        std::uint32_t gathered[width];
+                        word_type block[16];
+                        for (std::size_t offset = 0; offset < padded_bytes; offset += block_bytes) {
+                            for (std::size_t t = 0; t < 16; ++t) {
+                                for (std::size_t l = 0; l < width; ++l) {
+                                    gathered[l] = load_be(padded[l].data() + offset + 4 * t);
+                                }
+                                block[t] = lanes_type::load(gathered);
+                            }
+                            compress(state, block);
+                        }
+
+                        for (std::size_t i = 0; i < 8; ++i) {
+                            lanes_type::store(gathered, state[i]);
+                            for (std::size_t l = 0; l < width; ++l) {
+                                store_be(digests[l] + 4 * i, gathered[l]);
+                            }
+                        }
+                    }
+
+                private:
+                    static void pad(const std::uint8_t *message, std::uint8_t *out) {
+                        std::memcpy(out, message, MessageBytes);
+                        std::memset(out + MessageBytes, 0, padded_bytes - MessageBytes);
+                        out[MessageBytes] = 0x80;
+                        const std::uint64_t bit_length = static_cast<std::uint64_t>(MessageBytes) * 8;
+                        for (std::size_t i = 0; i < 8; ++i) {
+                            out[padded_bytes - 1 - i] = static_cast<std::uint8_t>(bit_length >> (8 * i));
+                        }
+                    }
+
+                    static std::uint32_t load_be(const std::uint8_t *p) {
+                        return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) |
+                               (std::uint32_t(p[2]) << 8) | std::uint32_t(p[3]);
+                    }
+
+                    static void store_be(std::uint8_t *p, std::uint32_t x) {
+                        p[0] = static_cast<std::uint8_t>(x >> 24);
+                        p[1] = static_cast<std::uint8_t>(x >> 16);
+                        p[2] = static_cast<std::uint8_t>(x >> 8);
+                        p[3] = static_cast<std::uint8_t>(x);
+                    }
+
+                    static void compress(word_type *state, const word_type *block) {
+                        static const std::uint32_t k[64] = {
+                            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+                            0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+                            0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+                            0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+                            0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+                            0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+                            0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+                            0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+                            0xc67178f2};
+
+                        typedef lanes_type L;
+
+                        word_type w[64];
+                        for (std::size_t t = 0; t < 16; ++t) {
+                            w[t] = block[t];
+                        }
+                        for (std::size_t t = 16; t < 64; ++t) {
+                            word_type s0 = L::bxor(L::bxor(L::template rotr<7>(w[t - 15]), L::template rotr<18>(w[t - 15])),
+                                                   L::template shr<3>(w[t - 15]));
+                            word_type s1 = L::bxor(L::bxor(L::template rotr<17>(w[t - 2]), L::template rotr<19>(w[t - 2])),
+                                                   L::template shr<10>(w[t - 2]));
+                            w[t] = L::add(L::add(w[t - 16], s0), L::add(w[t - 7], s1));
+                        }
+
+                        word_type a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5],
+                                  g = state[6], h = state[7];
+                        for (std::size_t t = 0; t < 64; ++t) {
+                            word_type big_s1 = L::bxor(L::bxor(L::template rotr<6>(e), L::template rotr<11>(e)),
+                                                       L::template rotr<25>(e));
+                            word_type ch = L::bxor(L::band(e, f), L::bandnot(e, g));
+                            word_type t1 =
+                                L::add(L::add(L::add(h, big_s1), L::add(ch, L::set1(k[t]))), w[t]);
+                            word_type big_s0 = L::bxor(L::bxor(L::template rotr<2>(a), L::template rotr<13>(a)),
+                                                       L::template rotr<22>(a));
+                            word_type maj = L::bxor(L::bxor(L::band(a, b), L::band(a, c)), L::band(b, c));
+                            word_type t2 = L::add(big_s0, maj);
+
+                            h = g;
+                            g = f;
+                            f = e;
+                            e = L::add(d, t1);
+                            d = c;
+                            c = b;
+                            b = a;
+                            a = L::add(t1, t2);
+                        }
+
+                        state[0] = L::add(state[0], a);
+                        state[1] = L::add(state[1], b);
+                        state[2] = L::add(state[2], c);
+                        state[3] = L::add(state[3], d);
+                        state[4] = L::add(state[4], e);
+                        state[5] = L::add(state[5], f);
+                        state[6] = L::add(state[6], g);
+                        state[7] = L::add(state[7], h);
+                    }
+                };
+            }    // namespace detail
+        }        // namespace containers
+    }            // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_CONTAINER_DETAIL_SHA256_LANES_HPP
@@ -0,0 +1,347 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_ASYNC_HPP
+#define CRYPTO3_MERKLE_ASYNC_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <nil/crypto3/container/detail/parallelization.hpp>
+#include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/proof.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            // Asynchronous tree construction and proof verification.
+            //
+            // The work is cut into tasks of 'chunk_size' units (nodes to hash, proofs to check) which
+            // are run one after another through a user-supplied executor: any callable taking a
+            // nullary function object and running it later, e.g.
+            //     [&io](std::function<void()> f) { boost::asio::post(io, std::move(f)); }
+            // Every task posts the next one, so a reactor thread stays responsive between tasks,
+            // and the operation can be cancelled in between. The completion handler is called on
+            // the executor as handler(error, result); 'error' is null on success and holds an
+            // async_cancelled if the operation was cancelled.
+
+            class async_cancelled : public std::runtime_error {
+            public:
+                async_cancelled() : std::runtime_error("merkle: asynchronous operation cancelled") {
+                }
+            };
+
+            // Cancellation flag shared by copies, so it can be handed to an operation and kept by its owner.
+            class async_cancellation {
+            public:
+                async_cancellation() : _flag(std::make_shared<std::atomic<bool>>(false)) {
+                }
+
+                void cancel() const {
+                    _flag->store(true, std::memory_order_relaxed);
+                }
+
+                bool is_cancelled() const {
+                    return _flag->load(std::memory_order_relaxed);
+                }
+
+            private:
+                std::shared_ptr<std::atomic<bool>> _flag;
+            };
+
+            struct async_options {
+                // Work units per task.
+                std::size_t chunk_size = 4096;
+                // Threads sharing every task, as in make_merkle_tree(first, last, threads).
+                std::size_t threads = 1;
+                async_cancellation cancellation;
+                // Called on the executor after every task with the completed and total work units.
+                std::function<void(std::size_t, std::size_t)> progress;
+            };
+
+            namespace detail {
+                // Runs 'step' through 'executor' until it returns true, then calls the handler with
+                // 'result'. 'step(begin, end)' processes the work units [begin, end).
+                template<typename Result, typename Executor, typename Step, typename Handler>
+                class async_chunked_operation
+                    : public std::enable_shared_from_this<async_chunked_operation<Result, Executor, Step, Handler>> {
+                public:
+                    async_chunked_operation(std::size_t total, Executor executor, Step step, Handler handler,
+                                            async_options options) :
+                        _total(total),
+                        _completed(0), _executor(std::move(executor)), _step(std::move(step)),
+                        _handler(std::move(handler)), _options(std::move(options)) {
+                        _options.chunk_size = std::max<std::size_t>(1, _options.chunk_size);
+                    }
+
+                    void post() {
+                        std::shared_ptr<async_chunked_operation> self = this->shared_from_this();
+                        _executor([self]() { self->run(); });
+                    }
+
+                private:
+                    void run() {
+                        if (_options.cancellation.is_cancelled()) {
+                            _handler(std::make_exception_ptr(async_cancelled()), Result());
+                            return;
+                        }
+                        bool done;
+                        try {
+                            const std::size_t end = _completed + std::min(_options.chunk_size, _total - _completed);
+                            done = _step(_completed, end, _options.threads) || end == _total;
+                            _completed = end;
+                            if (_options.progress) {
+                                _options.progress(_completed, _total);
+                            }
+                        } catch (...) {
+                            _handler(std::current_exception(), Result());
+                            return;
+                        }
+                        if (done) {
+                            _handler(std::exception_ptr(), _step.result());
+                        } else {
+                            post();
+                        }
+                    }
+
+                    std::size_t _total;
+                    std::size_t _completed;
+                    Executor _executor;
+                    Step _step;
+                    Handler _handler;
+                    async_options _options;
+                };
+
+                template<typename Result, typename Executor, typename Step, typename Handler>
+                void start_async_chunked_operation(std::size_t total, Executor executor, Step step, Handler handler,
+                                                   async_options options) {
+                    std::make_shared<async_chunked_operation<Result, Executor, Step, Handler>>(
+                        total, std::move(executor), std::move(step), std::move(handler), std::move(options))
+                        ->post();
+                }
+
+                // Builds a tree node by node in the order of the serial make_merkle_tree: the work units
+                // are the leaves, then the nodes of every row bottom-up.
+                template<typename NodeType, std::size_t Arity, typename LeafIterator>
+                class async_merkle_tree_build {
+                public:
+                    typedef merkle_tree_impl<NodeType, Arity> tree_type;
+                    typedef typename NodeType::hash_type hash_type;
+
+                    async_merkle_tree_build(LeafIterator first, std::size_t leaves) :
+                        _first(first), _tree(leaves), _row(0), _row_begin(0), _row_len(leaves) {
+                        _tree.resize(_tree.complete_size());
+                    }
+
+                    std::size_t total() const {
+                        return _tree.complete_size();
+                    }
+
+                    bool operator()(std::size_t begin, std::size_t end, std::size_t threads) {
+                        while (begin != end) {
+                            const std::size_t n = std::min(end - begin, _row_begin + _row_len - begin);
+                            const std::size_t first_pos = begin - _row_begin;
+                            tree_type &tree = _tree;
+                            if (_row == 0) {
+                                const LeafIterator leaves = _first;
+                                parallel_for(first_pos, first_pos + n, threads,
+                                             [&tree, leaves](std::size_t b, std::size_t e) {
+                                                 LeafIterator leaf = std::next(leaves, b);
+                                                 for (std::size_t i = b; i < e; ++i) {
+                                                     tree[i] = crypto3::hash<hash_type>(*leaf++);
+                                                 }
+                                             });
+                                CRYPTO3_CONTAINERS_COUNT(accumulator_construction, n);
+                                CRYPTO3_CONTAINERS_COUNT(hash_invocation, n);
+                            } else {
+                                // Work units are numbered as the nodes are stored, in level order.
+                                const std::size_t children_begin_idx = _row_begin - _row_len * Arity,
+                                                  row_begin_idx = _row_begin;
+                                parallel_for(first_pos, first_pos + n, threads,
+                                             [&tree, children_begin_idx, row_begin_idx](std::size_t b, std::size_t e) {
+                                                 batch_node_hasher<hash_type, Arity>::process(
+                                                     tree.begin() + children_begin_idx + b * Arity, e - b,
+                                                     tree.begin() + row_begin_idx + b);
+                                             });
+                            }
+                            begin += n;
+                            if (begin == _row_begin + _row_len) {
+                                _row_begin += _row_len;
+                                _row_len /= Arity;
+                                ++_row;
+                            }
+                        }
+                        return _row == _tree.row_count();
+                    }
+
+                    tree_type result() {
+                        return std::move(_tree);
+                    }
+
+                private:
+                    LeafIterator _first;
+                    tree_type _tree;
+                    // Current row, its first work unit and its length.
+                    std::size_t _row;
+                    std::size_t _row_begin;
+                    std::size_t _row_len;
+                };
+
+                // Checks proof i against leaf i; stops at the first failure.
+                template<typename ProofIterator, typename LeafIterator>
+                class async_proofs_validation {
+                public:
+                    async_proofs_validation(ProofIterator proofs, LeafIterator leaves) :
+                        _proofs(proofs), _leaves(leaves), _valid(true) {
+                    }
+
+                    bool operator()(std::size_t begin, std::size_t end, std::size_t threads) {
+                        std::atomic<bool> ok(true);
+                        const ProofIterator proofs = _proofs;
+                        const LeafIterator leaves = _leaves;
+                        parallel_for(begin, end, threads, [&ok, proofs, leaves](std::size_t b, std::size_t e) {
+                            ProofIterator proof = std::next(proofs, b);
+                            LeafIterator leaf = std::next(leaves, b);
+                            for (std::size_t i = b; i < e && ok.load(std::memory_order_relaxed); ++i) {
+                                if (!(proof++)->validate(*leaf++)) {
+                                    ok.store(false, std::memory_order_relaxed);
+                                }
+                            }
+                        });
+                        _valid = ok.load();
+                        return !_valid;
+                    }
+
+                    bool result() {
+                        return _valid;
+                    }
+
+                private:
+                    ProofIterator _proofs;
+                    LeafIterator _leaves;
+                    bool _valid;
+                };
+
+                template<typename Result>
+                struct async_promise_handler {
+                    void operator()(std::exception_ptr error, Result result) {
+                        if (error) {
+                            promise->set_exception(error);
+                        } else {
+                            promise->set_value(std::move(result));
+                        }
+                    }
+
+                    std::shared_ptr<std::promise<Result>> promise;
+                };
+            }    // namespace detail
+
+            // Asynchronous make_merkle_tree(first, last, threads) over random-access leaves, which must
+            // stay alive until completion. Work units are the nodes of the tree.
+            template<typename T, std::size_t Arity, typename LeafIterator, typename Executor, typename Handler>
+            void async_make_merkle_tree(LeafIterator first, LeafIterator last, Executor executor, Handler handler,
+                                        async_options options = async_options()) {
+                typedef typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                                  detail::merkle_tree_node<T>, T>::type node_type;
+                typedef detail::async_merkle_tree_build<node_type, Arity, LeafIterator> step_type;
+
+                step_type step(first, std::distance(first, last));
+                const std::size_t total = step.total();
+                detail::start_async_chunked_operation<typename step_type::tree_type>(
+                    total, std::move(executor), std::move(step), std::move(handler), std::move(options));
+            }
+
+            template<typename T, std::size_t Arity, typename LeafIterator, typename Executor>
+            std::future<merkle_tree<T, Arity>> async_make_merkle_tree(LeafIterator first, LeafIterator last,
+                                                                      Executor executor,
+                                                                      async_options options = async_options()) {
+                detail::async_promise_handler<merkle_tree<T, Arity>> handler {
+                    std::make_shared<std::promise<merkle_tree<T, Arity>>>()};
+                std::future<merkle_tree<T, Arity>> result = handler.promise->get_future();
+                async_make_merkle_tree<T, Arity>(first, last, std::move(executor), std::move(handler),
+                                                 std::move(options));
+                return result;
+            }
+
+            // Validates the proofs [first_proof, last_proof) against the leaves starting at 'first_leaf',
+            // both random-access and alive until completion. Work units are the proofs; the result is
+            // false as soon as a task finds an invalid one.
+            template<typename ProofIterator, typename LeafIterator, typename Executor, typename Handler>
+            void async_validate(ProofIterator first_proof, ProofIterator last_proof, LeafIterator first_leaf,
+                                Executor executor, Handler handler, async_options options = async_options()) {
+                detail::start_async_chunked_operation<bool>(
+                    std::distance(first_proof, last_proof), std::move(executor),
+                    detail::async_proofs_validation<ProofIterator, LeafIterator>(first_proof, first_leaf),
+                    std::move(handler), std::move(options));
+            }
+
+            template<typename ProofIterator, typename LeafIterator, typename Executor>
+            std::future<bool> async_validate(ProofIterator first_proof, ProofIterator last_proof,
+                                             LeafIterator first_leaf, Executor executor,
+                                             async_options options = async_options()) {
+                detail::async_promise_handler<bool> handler {std::make_shared<std::promise<bool>>()};
+                std::future<bool> result = handler.promise->get_future();
+                async_validate(first_proof, last_proof, first_leaf, std::move(executor), std::move(handler),
+                               std::move(options));
+                return result;
+            }
+
+            // validate_compressed_proofs checks the proofs against each other, so it runs as a single
+            // task; cancellation is only honoured before it starts.
+            template<typename ProofType, typename Hashable, typename Executor, typename Handler>
+            void async_validate_compressed_proofs(const std::vector<ProofType> &proofs,
+                                                  const std::vector<Hashable> &leaves, Executor executor,
+                                                  Handler handler, async_options options = async_options()) {
+                struct step_type {
+                    bool operator()(std::size_t, std::size_t, std::size_t) {
+                        valid = ProofType::validate_compressed_proofs(*proofs, *leaves);
+                        return true;
+                    }
+                    bool result() {
+                        return valid;
+                    }
+
+                    const std::vector<ProofType> *proofs;
+                    const std::vector<Hashable> *leaves;
+                    bool valid;
+                };
+                options.chunk_size = 1;
+                detail::start_async_chunked_operation<bool>(1, std::move(executor),
+                                                            step_type {&proofs, &leaves, false},
+                                                            std::move(handler), std::move(options));
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_ASYNC_HPP
@@ -0,0 +1,181 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_BATCH_HASHER_HPP
+#define CRYPTO3_MERKLE_BATCH_HASHER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include <nil/crypto3/hash/algorithm/hash.hpp>
+#include <nil/crypto3/hash/sha2.hpp>
+
+#include <nil/crypto3/container/detail/instrumentation.hpp>
+#include <nil/crypto3/container/detail/sha256_lanes.hpp>
+
+// Field-native Poseidon node hashing is opt-in: it reimplements the sponge of hashes::poseidon,
+// so roots only stay the same as long as both agree. Requires the Poseidon headers.
+#ifdef CRYPTO3_CONTAINERS_WITH_POSEIDON_NODE_HASH
+#include <tuple>
+#include <type_traits>
+
+#include <nil/crypto3/hash/poseidon.hpp>
+#include <nil/crypto3/hash/detail/poseidon/poseidon_permutation.hpp>
+#endif
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Parent of the children [first, last). The primary template feeds them one by one
+                // through the hash accumulator; hashes with a cheaper way of compressing whole
+                // groups specialize it.
+                template<typename Hash>
+                struct merkle_node_hash {
+                    template<typename InputIterator>
+                    static typename Hash::digest_type process(InputIterator first, InputIterator last) {
+                        CRYPTO3_CONTAINERS_COUNT(accumulator_construction, 1);
+                        accumulator_set<Hash> acc;
+                        while (first != last) {
+                            crypto3::hash<Hash>(*first++, acc);
+                        }
+                        return accumulators::extract::hash<Hash>(acc);
+                    }
+                };
+
+#ifdef CRYPTO3_CONTAINERS_WITH_POSEIDON_NODE_HASH
+                // Poseidon children already are field elements, so they are added straight into the
+                // sponge state, 'rate' of them per permutation (one permutation for a binary tree over
+                // the Mina parameters), without accumulator state or marshalling. This is the Mina
+                // sponge hashes::poseidon runs on: zero initial state, absorption from state word 0
+                // on, a permutation before every full block and one to squeeze state word 0.
+                template<typename PolicyType>
+                struct merkle_node_hash<hashes::poseidon<PolicyType>> {
+                    typedef hashes::poseidon<PolicyType> hash_type;
+                    typedef PolicyType policy_type;
+                    typedef typename policy_type::state_type state_type;
+                    typedef hashes::detail::poseidon_permutation<policy_type> permutation_type;
+
+                    constexpr static const std::size_t rate = policy_type::rate;
+
+                    static_assert(rate > 0 && rate < std::tuple_size<state_type>::value,
+                                  "Poseidon rate must leave at least one capacity word");
+                    static_assert(std::is_same<typename hash_type::digest_type,
+                                               typename state_type::value_type>::value,
+                                  "Poseidon digests must be state words");
+                    static_assert(std::is_same<typename hash_type::word_type,
+                                               typename state_type::value_type>::value,
+                                  "Poseidon children are absorbed as state words");
+
+                    template<typename InputIterator>
+                    static typename hash_type::digest_type process(InputIterator first, InputIterator last) {
+                        state_type state;
+                        std::fill(state.begin(), state.end(), typename state_type::value_type(0));
+                        for (std::size_t absorbed = 0; first != last; ++first, ++absorbed) {
+                            if (absorbed == rate) {
+                                permutation_type::permute(state);
+                                absorbed = 0;
+                            }
+                            state[absorbed] += *first;
+                        }
+                        permutation_type::permute(state);
+                        return state[0];
+                    }
+                };
+#endif
+
+                template<typename T, typename LeafIterator>
+                typename T::digest_type generate_hash(LeafIterator first, LeafIterator last) {
+                    CRYPTO3_CONTAINERS_COUNT(hash_invocation, 1);
+                    return merkle_node_hash<T>::process(first, last);
+                }
+
+                // Hashes 'groups' consecutive Arity-sized sibling groups starting at 'first' and
+                // writes one parent digest per group to 'out'. The tree builders hash whole rows
+                // through this, so a hash with a multi-lane kernel only has to specialize it;
+                // the primary template is the scalar fallback.
+                template<typename Hash, std::size_t Arity>
+                struct batch_node_hasher {
+                    typedef Hash hash_type;
+
+                    constexpr static const std::size_t lanes = 1;
+
+                    template<typename InputIterator, typename OutputIterator>
+                    static OutputIterator process(InputIterator first, std::size_t groups, OutputIterator out) {
+                        for (std::size_t i = 0; i < groups; ++i, first += Arity) {
+                            *out++ = generate_hash<hash_type>(first, first + Arity);
+                        }
+                        return out;
+                    }
+                };
+
+                // SHA-256 parents are the plain digest of the concatenated children, so groups are
+                // hashed native_lanes::width at a time (8 with AVX2, 4 with SSE2) and the remainder
+                // goes through the regular accumulator.
+                template<std::size_t Arity>
+                struct batch_node_hasher<hashes::sha2<256>, Arity> {
+                    typedef hashes::sha2<256> hash_type;
+                    typedef typename hash_type::digest_type digest_type;
+
+                    constexpr static const std::size_t digest_bytes = hash_type::digest_bits / 8;
+                    typedef sha256_lanes<native_lanes, Arity * digest_bytes> kernel_type;
+
+                    constexpr static const std::size_t lanes = kernel_type::width;
+
+                    template<typename InputIterator, typename OutputIterator>
+                    static OutputIterator process(InputIterator first, std::size_t groups, OutputIterator out) {
+                        std::array<std::array<std::uint8_t, Arity * digest_bytes>, lanes> messages;
+                        std::array<digest_type, lanes> digests;
+                        const std::uint8_t *message_ptrs[lanes];
+                        std::uint8_t *digest_ptrs[lanes];
+                        for (std::size_t l = 0; l < lanes; ++l) {
+                            message_ptrs[l] = messages[l].data();
+                            digest_ptrs[l] = digests[l].data();
+                        }
+
+                        for (; groups >= lanes; groups -= lanes) {
+                            for (std::size_t l = 0; l < lanes; ++l) {
+                                for (std::size_t i = 0; i < Arity; ++i, ++first) {
+                                    std::copy(std::begin(*first), std::end(*first),
+                                              messages[l].begin() + i * digest_bytes);
+                                }
+                            }
+                            kernel_type::process(message_ptrs, digest_ptrs);
+                            CRYPTO3_CONTAINERS_COUNT(hash_invocation, lanes);
+                            out = std::copy(digests.begin(), digests.end(), out);
+                        }
+                        for (; groups > 0; --groups, first += Arity) {
+                            *out++ = generate_hash<hash_type>(first, first + Arity);
+                        }
+                        return out;
+                    }
+                };
+            }    // namespace detail
+        }        // namespace containers
+    }            // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_BATCH_HASHER_HPP
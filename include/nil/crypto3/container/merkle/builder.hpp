@@ -0,0 +1,204 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_BUILDER_HPP
+#define CRYPTO3_MERKLE_BUILDER_HPP
+
+#include <array>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include <nil/crypto3/container/detail/pipeline.hpp>
+#include <nil/crypto3/container/merkle/tree.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            // Streaming builder sinks receive every node once, as soon as it is known:
+            // sink(row, position_in_row, hash), row 0 being the leaves.
+
+            // Keeps nothing, the builder then only yields the root.
+            struct merkle_tree_null_sink {
+                template<typename ValueType>
+                void operator()(std::size_t, std::size_t, const ValueType &) {
+                }
+            };
+
+            // Writes nodes at their merkle_tree_impl position into a container sized for a tree of
+            // 'leaves' leaves up front, e.g. a mapped_vector. The released container can be
+            // adopted by merkle_tree_impl(container_type &&). A node outside of that tree, e.g. from
+            // pushing more leaves than declared, throws std::length_error.
+            template<typename Container, std::size_t Arity>
+            class merkle_tree_storage_sink {
+            public:
+                typedef Container container_type;
+
+                merkle_tree_storage_sink(std::size_t leaves, container_type &&storage) : _storage(std::move(storage)) {
+                    for (std::size_t row_begin_idx = 0, row_len = leaves; row_len > 0; row_len /= Arity) {
+                        _row_begin_idxs.emplace_back(row_begin_idx);
+                        _row_lens.emplace_back(row_len);
+                        row_begin_idx += row_len;
+                    }
+                    _storage.clear();
+                    _storage.resize(detail::merkle_tree_length(leaves, Arity));
+                }
+
+                template<typename ValueType>
+                void operator()(std::size_t row, std::size_t pos, const ValueType &x) {
+                    if (row >= _row_lens.size() || pos >= _row_lens[row]) {
+                        throw std::length_error("merkle tree storage sink: node outside of the declared tree");
+                    }
+                    _storage[_row_begin_idxs[row] + pos] = x;
+                }
+
+                container_type release() {
+                    return std::move(_storage);
+                }
+
+            private:
+                container_type _storage;
+                std::vector<std::size_t> _row_begin_idxs;
+                std::vector<std::size_t> _row_lens;
+            };
+
+            namespace detail {
+                // Append-only merkle tree builder.
+                //
+                // Leaves are pushed one at a time or in chunks; only the right frontier, at most
+                // Arity nodes per row, is kept in memory. Every node is handed to the sink as soon
+                // as it is computed, so the whole tree never has to be materialized unless the
+                // sink does so.
+                template<typename NodeType, std::size_t Arity = 2, typename Sink = merkle_tree_null_sink>
+                class merkle_tree_builder_impl {
+                public:
+                    typedef NodeType node_type;
+                    typedef typename node_type::hash_type hash_type;
+                    typedef typename node_type::value_type value_type;
+                    typedef Sink sink_type;
+
+                    merkle_tree_builder_impl() : _leaves(0) {
+                    }
+
+                    explicit merkle_tree_builder_impl(sink_type &&sink) : _sink(std::move(sink)), _leaves(0) {
+                    }
+
+                    // A leaf the sink rejects by throwing leaves the builder as it was.
+                    template<typename Hashable>
+                    void push(const Hashable &leaf) {
+                        push_node(crypto3::hash<hash_type>(leaf));
+                        ++_leaves;
+                    }
+
+                    template<typename LeafIterator>
+                    void push(LeafIterator first, LeafIterator last) {
+                        while (first != last) {
+                            push(*first++);
+                        }
+                    }
+
+                    // Same as push(first, last), overlapping reading the leaves with hashing them: a
+                    // reader thread fetches chunks of 'chunk_size' leaves ahead into a ring buffer while
+                    // 'threads' workers hash them, and the calling thread feeds the hashes to the tree in
+                    // order. Meant for slow single-pass inputs, e.g. a large file read through
+                    // std::istream_iterator, which then is committed at the pace of the slower of the two.
+                    template<typename LeafIterator>
+                    void push(LeafIterator first, LeafIterator last, std::size_t threads,
+                              std::size_t chunk_size = 4096) {
+                        typedef typename std::iterator_traits<LeafIterator>::value_type leaf_type;
+
+                        pipelined_transform(
+                            first, last, chunk_size, threads + 2, threads,
+                            [](const leaf_type &leaf) { return crypto3::hash<hash_type>(leaf); },
+                            [this](const value_type &x) {
+                                push_node(x);
+                                ++_leaves;
+                            });
+                    }
+
+                    std::size_t leaves() const {
+                        return _leaves;
+                    }
+
+                    // True once the pushed leaves form a complete tree, i.e. their number is a power of Arity.
+                    bool is_complete() const {
+                        if (_frontier.empty() || _filled.back() != 1) {
+                            return false;
+                        }
+                        return std::all_of(_filled.begin(), _filled.end() - 1,
+                                           [](std::size_t filled) { return filled == 0; });
+                    }
+
+                    value_type root() const {
+                        BOOST_ASSERT_MSG(is_complete(), "Number of leaves must be a power of Arity");
+                        return _frontier.back()[0];
+                    }
+
+                    sink_type &sink() {
+                        return _sink;
+                    }
+
+                    const sink_type &sink() const {
+                        return _sink;
+                    }
+
+                private:
+                    void push_node(value_type x) {
+                        for (std::size_t row = 0;; ++row) {
+                            if (row == _frontier.size()) {
+                                _frontier.emplace_back();
+                                _filled.emplace_back(0);
+                                _row_sizes.emplace_back(0);
+                            }
+                            _sink(row, _row_sizes[row], x);
+                            ++_row_sizes[row];
+                            _frontier[row][_filled[row]++] = x;
+                            if (_filled[row] != Arity) {
+                                return;
+                            }
+                            _filled[row] = 0;
+                            x = generate_hash<hash_type>(_frontier[row].begin(), _frontier[row].end());
+                        }
+                    }
+
+                    sink_type _sink;
+                    std::size_t _leaves;
+                    // Pending nodes of every row, the number of them and the number of nodes emitted so far.
+                    std::vector<std::array<value_type, Arity>> _frontier;
+                    std::vector<std::size_t> _filled;
+                    std::vector<std::size_t> _row_sizes;
+                };
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity, typename Sink = merkle_tree_null_sink>
+            using merkle_tree_builder =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_tree_builder_impl<detail::merkle_tree_node<T>, Arity, Sink>,
+                                          detail::merkle_tree_builder_impl<T, Arity, Sink>>::type;
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_BUILDER_HPP
@@ -0,0 +1,239 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_CACHED_TREE_HPP
+#define CRYPTO3_MERKLE_CACHED_TREE_HPP
+
+#include <vector>
+#include <iterator>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Hashes the 'Arity^rows' consecutive nodes starting at 'first' up 'rows' rows and
+                // returns the single node on top. 'scratch' is reused between calls.
+                template<typename Hash, std::size_t Arity, typename InputIterator, typename ValueType>
+                ValueType fold_merkle_rows(InputIterator first, std::size_t rows, std::vector<ValueType> &scratch) {
+                    if (rows == 0) {
+                        return *first;
+                    }
+
+                    std::size_t row_len = 1;
+                    for (std::size_t i = 1; i < rows; ++i) {
+                        row_len *= Arity;
+                    }
+                    scratch.resize(row_len);
+                    batch_node_hasher<Hash, Arity>::process(first, row_len, scratch.begin());
+                    // Parent i only overwrites slot i after group i (slots i * Arity and up) was read,
+                    // so the remaining rows are folded in place.
+                    for (; row_len > 1; row_len /= Arity) {
+                        batch_node_hasher<Hash, Arity>::process(scratch.begin(), row_len / Arity, scratch.begin());
+                    }
+                    return scratch.front();
+                }
+
+                // Merkle tree that keeps the leaves and the top rows only.
+                //
+                // The 'rows_to_discard' internal rows right above the leaves are dropped after
+                // construction, the same memory/CPU tradeoff as the level cache trees of the
+                // merkle_light lineage. The kept part takes leaves() + merkle_tree_cache_size()
+                // hashes; a dropped node is recomputed from the leaves below it when requested,
+                // which costs about Arity^row / (Arity - 1) hashes.
+                //
+                // Layout: the leaf row, then rows 'rows_to_discard + 1' up to the root, bottom-up.
+                template<typename NodeType, std::size_t Arity = 2, typename StoragePolicy = vector_storage>
+                struct merkle_tree_cached_impl {
+                    typedef NodeType node_type;
+                    typedef StoragePolicy storage_policy_type;
+
+                    typedef typename node_type::hash_type hash_type;
+
+                    typedef typename node_type::value_type value_type;
+                    constexpr static const std::size_t value_bits = node_type::value_bits;
+
+                    typedef typename storage_policy_type::template container_type<value_type> container_type;
+
+                    typedef typename container_type::const_reference const_reference;
+                    typedef typename container_type::size_type size_type;
+                    typedef typename container_type::const_iterator const_iterator;
+
+                    merkle_tree_cached_impl() : _size(0), _leaves(0), _rc(0), _rows_to_discard(0) {
+                    }
+
+                    // Takes over the hashes of a cached tree with 'leaves' leaves, laid out as above.
+                    merkle_tree_cached_impl(container_type &&hashes, size_t leaves, size_t rows_to_discard) :
+                        _hashes(std::move(hashes)), _size(detail::merkle_tree_length(leaves, Arity)), _leaves(leaves),
+                        _rc(detail::merkle_tree_row_count(leaves, Arity)), _rows_to_discard(rows_to_discard) {
+                        BOOST_ASSERT_MSG(_hashes.size() ==
+                                             _leaves + detail::merkle_tree_cache_size(_leaves, Arity, _rows_to_discard),
+                                         "Wrong number of hashes for a cached tree");
+                    }
+
+                    const_iterator begin() const BOOST_NOEXCEPT {
+                        return _hashes.begin();
+                    }
+
+                    const_iterator end() const BOOST_NOEXCEPT {
+                        return _hashes.end();
+                    }
+
+                    // Number of hashes actually kept.
+                    size_type size() const BOOST_NOEXCEPT {
+                        return _hashes.size();
+                    }
+
+                    // Number of hashes of the complete tree.
+                    size_type complete_size() const BOOST_NOEXCEPT {
+                        return _size;
+                    }
+
+                    size_t row_count() const {
+                        return _rc;
+                    }
+
+                    size_t leaves() const {
+                        return _leaves;
+                    }
+
+                    size_t rows_to_discard() const {
+                        return _rows_to_discard;
+                    }
+
+                    bool is_row_cached(size_t row) const {
+                        return row == 0 || row > _rows_to_discard;
+                    }
+
+                    value_type root() const {
+                        return _hashes.back();
+                    }
+
+                    // Node 'pos' of row 'row' (row 0 being the leaves), recomputed if its row was discarded.
+                    value_type node(size_t row, size_t pos) const {
+                        if (is_row_cached(row)) {
+                            return _hashes[row_offset(row) + pos];
+                        }
+                        std::size_t first_leaf = pos;
+                        for (std::size_t i = 0; i < row; ++i) {
+                            first_leaf *= Arity;
+                        }
+                        std::vector<value_type> scratch;
+                        return fold_merkle_rows<hash_type, Arity>(_hashes.begin() + first_leaf, row, scratch);
+                    }
+
+                private:
+                    // Index of the first node of a cached row.
+                    size_t row_offset(size_t row) const {
+                        if (row == 0) {
+                            return 0;
+                        }
+                        std::size_t offset = _leaves, row_len = _leaves;
+                        for (std::size_t r = 1; r < row; ++r) {
+                            row_len /= Arity;
+                            if (r > _rows_to_discard) {
+                                offset += row_len;
+                            }
+                        }
+                        return offset;
+                    }
+
+                    container_type _hashes;
+
+                    size_t _size;
+                    size_t _leaves;
+                    size_t _rc;
+                    size_t _rows_to_discard;
+                };
+
+                template<typename T, std::size_t Arity, typename StoragePolicy, typename LeafIterator>
+                merkle_tree_cached_impl<T, Arity, StoragePolicy> make_cached_merkle_tree(
+                    LeafIterator first, LeafIterator last, std::size_t rows_to_discard,
+                    typename merkle_tree_cached_impl<T, Arity, StoragePolicy>::container_type &&storage) {
+                    typedef T node_type;
+                    typedef typename node_type::hash_type hash_type;
+                    typedef typename node_type::value_type value_type;
+
+                    const std::size_t leaves = std::distance(first, last);
+                    BOOST_ASSERT_MSG(detail::is_power_of(leaves, Arity),
+                                     "Wrong leaves number, it must be a power of Arity.");
+
+                    storage.clear();
+                    storage.reserve(leaves + detail::merkle_tree_cache_size(leaves, Arity, rows_to_discard));
+                    while (first != last) {
+                        storage.emplace_back(crypto3::hash<hash_type>(*first++));
+                    }
+
+                    // The first kept row is built slice by slice, so the discarded rows are never
+                    // materialized as a whole.
+                    std::size_t slice_len = Arity;
+                    for (std::size_t i = 0; i < rows_to_discard; ++i) {
+                        slice_len *= Arity;
+                    }
+                    std::vector<value_type> scratch;
+                    for (std::size_t slice_begin = 0; slice_begin < leaves; slice_begin += slice_len) {
+                        storage.emplace_back(fold_merkle_rows<hash_type, Arity>(storage.begin() + slice_begin,
+                                                                                rows_to_discard + 1, scratch));
+                    }
+
+                    std::size_t row_begin_idx = leaves;
+                    for (std::size_t row_len = leaves / slice_len; row_len > 1; row_len /= Arity) {
+                        batch_node_hasher<hash_type, Arity>::process(storage.begin() + row_begin_idx, row_len / Arity,
+                                                                     std::back_inserter(storage));
+                        row_begin_idx += row_len;
+                    }
+                    return merkle_tree_cached_impl<T, Arity, StoragePolicy>(std::move(storage), leaves,
+                                                                            rows_to_discard);
+                }
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity, typename StoragePolicy = vector_storage>
+            using cached_merkle_tree =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_tree_cached_impl<detail::merkle_tree_node<T>, Arity, StoragePolicy>,
+                                          detail::merkle_tree_cached_impl<T, Arity, StoragePolicy>>::type;
+
+            template<typename T, std::size_t Arity, typename StoragePolicy, typename LeafIterator>
+            cached_merkle_tree<T, Arity, StoragePolicy>
+                make_cached_merkle_tree(LeafIterator first, LeafIterator last, std::size_t rows_to_discard,
+                                        typename cached_merkle_tree<T, Arity, StoragePolicy>::container_type &&storage) {
+                return detail::make_cached_merkle_tree<
+                    typename std::conditional<nil::crypto3::detail::is_hash<T>::value, detail::merkle_tree_node<T>,
+                                              T>::type,
+                    Arity, StoragePolicy>(first, last, rows_to_discard, std::move(storage));
+            }
+
+            template<typename T, std::size_t Arity, typename LeafIterator>
+            cached_merkle_tree<T, Arity> make_cached_merkle_tree(LeafIterator first, LeafIterator last,
+                                                                 std::size_t rows_to_discard) {
+                return make_cached_merkle_tree<T, Arity, vector_storage>(
+                    first, last, rows_to_discard, typename cached_merkle_tree<T, Arity>::container_type());
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_CACHED_TREE_HPP
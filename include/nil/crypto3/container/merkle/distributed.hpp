@@ -0,0 +1,194 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_DISTRIBUTED_HPP
+#define CRYPTO3_MERKLE_DISTRIBUTED_HPP
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/proof.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            // A tree too large for one machine is split into K subtrees of L leaves each, K and L
+            // powers of Arity: subtree k is an ordinary tree over the leaves [k * L, (k + 1) * L),
+            // built wherever convenient. Only the summaries of the subtrees are gathered in one
+            // place, where a top tree over their roots completes the full tree. Its root and
+            // proofs are those of make_merkle_tree over all the K * L leaves.
+
+            // What a subtree builder exports.
+            template<typename ValueType>
+            struct merkle_subtree_summary {
+                typedef ValueType value_type;
+
+                // Position of the subtree among all of them.
+                std::size_t index;
+                std::size_t leaves;
+                std::size_t row_count;
+                value_type root;
+
+                bool operator==(const merkle_subtree_summary &rhs) const {
+                    return index == rhs.index && leaves == rhs.leaves && row_count == rhs.row_count &&
+                           root == rhs.root;
+                }
+                bool operator!=(const merkle_subtree_summary &rhs) const {
+                    return !(rhs == *this);
+                }
+            };
+
+            template<typename NodeType, std::size_t Arity, typename StoragePolicy, typename Layout>
+            merkle_subtree_summary<typename NodeType::value_type>
+                export_merkle_subtree(const detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> &subtree,
+                                      std::size_t index) {
+                return {index, subtree.leaves(), subtree.row_count(), subtree.root()};
+            }
+
+            namespace detail {
+                // Top rows of a distributed tree: a tree whose leaves are the subtree roots as they are.
+                template<typename NodeType, std::size_t Arity = 2>
+                class merkle_top_tree_impl {
+                public:
+                    typedef NodeType node_type;
+                    typedef typename node_type::hash_type hash_type;
+                    typedef typename node_type::value_type value_type;
+                    typedef merkle_subtree_summary<value_type> summary_type;
+                    typedef merkle_tree_impl<node_type, Arity> tree_type;
+                    typedef merkle_proof_impl<node_type, Arity> proof_type;
+
+                    constexpr static const std::size_t arity = Arity;
+
+                    merkle_top_tree_impl() : _subtree_leaves(0), _subtree_rc(0) {
+                    }
+
+                    // Takes the summaries of all the subtrees, in any order. Throws
+                    // std::invalid_argument if they do not describe one complete tree.
+                    template<typename SummaryIterator>
+                    merkle_top_tree_impl(SummaryIterator first, SummaryIterator last) : _summaries(first, last) {
+                        std::sort(_summaries.begin(), _summaries.end(),
+                                  [](const summary_type &a, const summary_type &b) { return a.index < b.index; });
+                        if (!detail::is_power_of(_summaries.size(), Arity)) {
+                            throw std::invalid_argument("merkle top tree: subtree count must be a power of Arity");
+                        }
+                        _subtree_leaves = _summaries.front().leaves;
+                        _subtree_rc = _summaries.front().row_count;
+                        if (!detail::is_power_of(_subtree_leaves, Arity) ||
+                            _subtree_rc != detail::merkle_tree_row_count(_subtree_leaves, Arity)) {
+                            throw std::invalid_argument("merkle top tree: inconsistent subtree geometry");
+                        }
+                        for (std::size_t k = 0; k < _summaries.size(); ++k) {
+                            if (_summaries[k].index != k || _summaries[k].leaves != _subtree_leaves ||
+                                _summaries[k].row_count != _subtree_rc) {
+                                throw std::invalid_argument("merkle top tree: missing, repeated or mismatched subtree");
+                            }
+                        }
+
+                        _top = tree_type(_summaries.size());
+                        _top.resize(_top.complete_size());
+                        for (std::size_t k = 0; k < _summaries.size(); ++k) {
+                            _top[k] = _summaries[k].root;
+                        }
+                        const typename tree_type::mapping_type mapping(_summaries.size());
+                        for (std::size_t row = 1, row_len = _summaries.size() / Arity; row < _top.row_count();
+                             ++row, row_len /= Arity) {
+                            hash_merkle_row<hash_type, Arity>(_top.begin(), mapping, row, 0, row_len);
+                        }
+                    }
+
+                    std::size_t subtrees() const {
+                        return _summaries.size();
+                    }
+
+                    std::size_t subtree_leaves() const {
+                        return _subtree_leaves;
+                    }
+
+                    const summary_type &summary(std::size_t k) const {
+                        return _summaries[k];
+                    }
+
+                    // Leaves and rows of the full tree.
+                    std::size_t leaves() const {
+                        return _summaries.size() * _subtree_leaves;
+                    }
+
+                    std::size_t row_count() const {
+                        return _subtree_rc + _top.row_count() - 1;
+                    }
+
+                    value_type root() const {
+                        return _top.root();
+                    }
+
+                    // The tree over the subtree roots, row 0 holding the roots themselves.
+                    const tree_type &top() const {
+                        return _top;
+                    }
+
+                    // Proof of leaf 'leaf_idx' of the full tree: the path in the subtree holding it
+                    // followed by the path of that subtree root in the top tree.
+                    template<typename SubtreeNodeType, typename StoragePolicy, typename Layout>
+                    proof_type proof(const merkle_tree_impl<SubtreeNodeType, Arity, StoragePolicy, Layout> &subtree,
+                                     std::size_t leaf_idx) const {
+                        BOOST_ASSERT_MSG(leaf_idx < leaves(), "Leaf index out of range");
+                        const std::size_t k = leaf_idx / _subtree_leaves;
+                        BOOST_ASSERT_MSG(subtree.leaves() == _subtree_leaves && subtree.root() == _summaries[k].root,
+                                         "The subtree does not hold the leaf");
+
+                        const proof_type lower(subtree, leaf_idx % _subtree_leaves), upper(_top, k);
+                        typename proof_type::path_type path(lower.path().begin(), lower.path().end());
+                        path.insert(path.end(), upper.path().begin(), upper.path().end());
+                        return proof_type(leaf_idx, root(), path);
+                    }
+
+                private:
+                    std::vector<summary_type> _summaries;
+                    std::size_t _subtree_leaves;
+                    std::size_t _subtree_rc;
+                    tree_type _top;
+                };
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity>
+            using merkle_top_tree =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_top_tree_impl<detail::merkle_tree_node<T>, Arity>,
+                                          detail::merkle_top_tree_impl<T, Arity>>::type;
+
+            template<typename T, std::size_t Arity, typename SummaryIterator>
+            merkle_top_tree<T, Arity> make_merkle_top_tree(SummaryIterator first, SummaryIterator last) {
+                return merkle_top_tree<T, Arity>(first, last);
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_DISTRIBUTED_HPP
@@ -0,0 +1,210 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+
+#ifndef CRYPTO3_MERKLE_FIXED_PROOF_HPP
+#define CRYPTO3_MERKLE_FIXED_PROOF_HPP
+
+#include <array>
+#include <stdexcept>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/fixed_tree.hpp>
+#include <nil/crypto3/container/merkle/proof.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Merkle proof for trees of at most 'MaxDepth' rows above the leaves, held inline.
+                //
+                // Creating, copying and validating it never allocates. Only the sibling hashes are
+                // kept, Arity - 1 per row in ascending position; the position of the path node in
+                // every row is derived from the leaf index, so the proof also binds the leaf index.
+                template<typename NodeType, std::size_t Arity, std::size_t MaxDepth>
+                class merkle_fixed_proof_impl {
+                    typedef merkle_path_iterator<Arity> path_iterator;
+
+                public:
+                    typedef NodeType node_type;
+                    typedef typename node_type::hash_type hash_type;
+
+                    constexpr static const std::size_t arity = Arity;
+                    constexpr static const std::size_t max_depth = MaxDepth;
+
+                    constexpr static const std::size_t value_bits = node_type::value_bits;
+                    typedef typename node_type::value_type value_type;
+
+                    typedef std::array<value_type, Arity - 1> layer_type;
+                    typedef merkle_proof_impl<NodeType, Arity> proof_type;
+
+                    merkle_fixed_proof_impl() : _li(0), _root(value_type()), _depth(0), _path() {
+                    }
+
+                    template<typename TreeNodeType, typename StoragePolicy, typename Layout>
+                    merkle_fixed_proof_impl(const merkle_tree_impl<TreeNodeType, Arity, StoragePolicy, Layout> &tree,
+                                            std::size_t leaf_idx) {
+                        assign(tree, leaf_idx);
+                    }
+
+                    template<typename TreeNodeType, std::size_t LeafCount>
+                    merkle_fixed_proof_impl(const merkle_tree_fixed_impl<TreeNodeType, Arity, LeafCount> &tree,
+                                            std::size_t leaf_idx) {
+                        static_assert(merkle_tree_fixed_impl<TreeNodeType, Arity, LeafCount>::row_count() - 1 <=
+                                          MaxDepth,
+                                      "Tree is deeper than the proof capacity");
+                        assign(tree, leaf_idx);
+                    }
+
+                    // Takes the siblings of a regular proof. Throws std::length_error if it is deeper than
+                    // MaxDepth, std::invalid_argument if its leaf index does not fit its depth or its
+                    // positions do not agree with its leaf index.
+                    explicit merkle_fixed_proof_impl(const proof_type &proof) :
+                        _li(proof.leaf_index()), _root(proof.root()), _depth(proof.path().size()), _path() {
+                        check_depth(_depth, "merkle fixed proof: proof is deeper than the proof capacity");
+                        if (!leaf_index_fits(_li, _depth)) {
+                            throw std::invalid_argument("merkle fixed proof: leaf index out of range");
+                        }
+                        for (path_iterator it(_li); it.row() < _depth; ++it) {
+                            for (std::size_t i = 0; i < Arity - 1; ++i) {
+                                if (proof.path()[it.row()][i].position() != it.sibling_index(i)) {
+                                    throw std::invalid_argument(
+                                        "merkle fixed proof: proof positions do not match its leaf index");
+                                }
+                            }
+                        }
+                        for (std::size_t row = 0; row < _depth; ++row) {
+                            for (std::size_t i = 0; i < Arity - 1; ++i) {
+                                _path[row][i] = proof.path()[row][i].hash();
+                            }
+                        }
+                    }
+
+                    explicit operator proof_type() const {
+                        typename proof_type::path_type path(_depth);
+                        for (path_iterator it(_li); it.row() < _depth; ++it) {
+                            for (std::size_t i = 0; i < Arity - 1; ++i) {
+                                path[it.row()][i] =
+                                    typename proof_type::path_element_type(_path[it.row()][i], it.sibling_index(i));
+                            }
+                        }
+                        return proof_type(_li, _root, path);
+                    }
+
+                    template<typename Hashable>
+                    bool validate(const Hashable &a) const {
+                        // the path only reads the low 'depth' digits of the leaf index, higher ones are forged
+                        if (!leaf_index_fits(_li, _depth)) {
+                            return false;
+                        }
+                        value_type d = crypto3::hash<hash_type>(a);
+                        std::array<value_type, Arity> children;
+                        for (path_iterator it(_li); it.row() < _depth; ++it) {
+                            for (std::size_t i = 0; i < Arity - 1; ++i) {
+                                children[it.sibling_index(i)] = _path[it.row()][i];
+                            }
+                            children[it.child_index()] = d;
+                            d = generate_hash<hash_type>(children.begin(), children.end());
+                        }
+                        return d == _root;
+                    }
+
+                    std::size_t leaf_index() const {
+                        return _li;
+                    }
+
+                    const value_type &root() const {
+                        return _root;
+                    }
+
+                    // Number of rows above the leaf actually used.
+                    std::size_t depth() const {
+                        return _depth;
+                    }
+
+                    // Siblings of the path node in row 'row', in ascending position.
+                    const layer_type &layer(std::size_t row) const {
+                        return _path[row];
+                    }
+
+                    bool operator==(const merkle_fixed_proof_impl &rhs) const {
+                        return _li == rhs._li && _root == rhs._root && _depth == rhs._depth &&
+                               std::equal(_path.begin(), _path.begin() + _depth, rhs._path.begin());
+                    }
+                    bool operator!=(const merkle_fixed_proof_impl &rhs) const {
+                        return !(rhs == *this);
+                    }
+
+                private:
+                    static void check_depth(std::size_t depth, const char *what) {
+                        if (depth > MaxDepth) {
+                            throw std::length_error(what);
+                        }
+                    }
+
+                    // Whether 'leaf_idx' is below Arity^depth; dividing it avoids overflowing the power.
+                    static bool leaf_index_fits(std::size_t leaf_idx, std::size_t depth) {
+                        for (std::size_t row = 0; row < depth && leaf_idx != 0; ++row) {
+                            leaf_idx /= Arity;
+                        }
+                        return leaf_idx == 0;
+                    }
+
+                    // Throws std::length_error if the tree is deeper than MaxDepth, std::out_of_range if
+                    // 'leaf_idx' is not a leaf of it.
+                    template<typename Tree>
+                    void assign(const Tree &tree, std::size_t leaf_idx) {
+                        check_depth(tree.row_count() - 1, "merkle fixed proof: tree is deeper than the proof capacity");
+                        if (leaf_idx >= tree.leaves()) {
+                            throw std::out_of_range("merkle fixed proof: leaf index out of range");
+                        }
+                        _li = leaf_idx;
+                        _root = tree.root();
+                        _depth = tree.row_count() - 1;
+
+                        for (path_iterator it(leaf_idx); it.row() < _depth; ++it) {
+                            for (std::size_t i = 0; i < Arity - 1; ++i) {
+                                _path[it.row()][i] = tree.node(it.row(), it.sibling(i));
+                            }
+                        }
+                    }
+
+                    std::size_t _li;
+                    value_type _root;
+                    std::size_t _depth;
+                    std::array<layer_type, MaxDepth> _path;
+                };
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity, std::size_t MaxDepth>
+            using fixed_merkle_proof =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_fixed_proof_impl<detail::merkle_tree_node<T>, Arity, MaxDepth>,
+                                          detail::merkle_fixed_proof_impl<T, Arity, MaxDepth>>::type;
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_FIXED_PROOF_HPP
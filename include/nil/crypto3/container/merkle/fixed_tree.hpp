@@ -0,0 +1,192 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+
+#ifndef CRYPTO3_MERKLE_FIXED_TREE_HPP
+#define CRYPTO3_MERKLE_FIXED_TREE_HPP
+
+#include <array>
+#include <iterator>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Geometry of a complete tree of 'LeafCount' leaves, all of it computed at compile time.
+                template<std::size_t Arity, std::size_t LeafCount>
+                struct merkle_tree_geometry {
+                    static_assert(Arity >= 2, "Arity must be at least 2");
+                    static_assert(is_power_of(LeafCount, Arity), "Wrong leaves number, it must be a power of Arity.");
+
+                    typedef merkle_tree_arity<Arity> arity_type;
+
+                    constexpr static const std::size_t leaves = LeafCount;
+                    constexpr static const std::size_t row_count = merkle_tree_row_count(LeafCount, Arity);
+                    constexpr static const std::size_t length = merkle_tree_length(LeafCount, Arity);
+
+                    // Index of the first node of every row, row 0 being the leaves.
+                    constexpr static std::array<std::size_t, row_count> make_row_offsets() {
+                        std::array<std::size_t, row_count> offsets {};
+                        for (std::size_t row = 1, row_len = LeafCount; row < row_count; ++row, row_len /= Arity) {
+                            offsets[row] = offsets[row - 1] + row_len;
+                        }
+                        return offsets;
+                    }
+
+                    constexpr static const std::array<std::size_t, row_count> row_offsets = make_row_offsets();
+                };
+
+                // Merkle tree with a leaf count fixed at compile time.
+                //
+                // Same layout as merkle_tree_impl, held inline in a std::array: building or copying
+                // it never allocates, and row offsets, row count and size are constants. Meant for
+                // circuits and recursion, where tree depths are fixed.
+                template<typename NodeType, std::size_t Arity, std::size_t LeafCount>
+                struct merkle_tree_fixed_impl {
+                    typedef NodeType node_type;
+                    typedef merkle_tree_geometry<Arity, LeafCount> geometry_type;
+
+                    typedef typename node_type::hash_type hash_type;
+
+                    typedef typename node_type::value_type value_type;
+                    constexpr static const std::size_t value_bits = node_type::value_bits;
+
+                    constexpr static const std::size_t arity = Arity;
+
+                    typedef std::array<value_type, geometry_type::length> container_type;
+
+                    typedef typename container_type::reference reference;
+                    typedef typename container_type::const_reference const_reference;
+                    typedef typename container_type::size_type size_type;
+                    typedef typename container_type::iterator iterator;
+                    typedef typename container_type::const_iterator const_iterator;
+
+                    bool operator==(const merkle_tree_fixed_impl &rhs) const {
+                        return _hashes == rhs._hashes;
+                    }
+
+                    bool operator!=(const merkle_tree_fixed_impl &rhs) const {
+                        return !(rhs == *this);
+                    }
+
+                    iterator begin() BOOST_NOEXCEPT {
+                        return _hashes.begin();
+                    }
+
+                    const_iterator begin() const BOOST_NOEXCEPT {
+                        return _hashes.begin();
+                    }
+
+                    iterator end() BOOST_NOEXCEPT {
+                        return _hashes.end();
+                    }
+
+                    const_iterator end() const BOOST_NOEXCEPT {
+                        return _hashes.end();
+                    }
+
+                    constexpr static size_type size() BOOST_NOEXCEPT {
+                        return geometry_type::length;
+                    }
+
+                    constexpr static size_t row_count() {
+                        return geometry_type::row_count;
+                    }
+
+                    constexpr static size_t leaves() {
+                        return geometry_type::leaves;
+                    }
+
+                    constexpr static size_t row_offset(size_t row) {
+                        return geometry_type::row_offsets[row];
+                    }
+
+                    reference operator[](size_type n) {
+                        return _hashes[n];
+                    }
+
+                    const_reference operator[](size_type n) const {
+                        return _hashes[n];
+                    }
+
+                    // Node 'pos' of row 'row', row 0 being the leaves.
+                    const_reference node(size_t row, size_t pos) const {
+                        return _hashes[row_offset(row) + pos];
+                    }
+
+                    value_type root() const {
+                        return _hashes.back();
+                    }
+
+                private:
+                    container_type _hashes;
+                };
+
+                template<typename T, std::size_t Arity, std::size_t LeafCount, typename LeafIterator>
+                merkle_tree_fixed_impl<T, Arity, LeafCount> make_fixed_merkle_tree(LeafIterator first,
+                                                                                   LeafIterator last) {
+                    typedef merkle_tree_fixed_impl<T, Arity, LeafCount> tree_type;
+                    typedef typename tree_type::hash_type hash_type;
+                    typedef typename tree_type::geometry_type geometry_type;
+
+                    BOOST_ASSERT_MSG(static_cast<std::size_t>(std::distance(first, last)) == LeafCount,
+                                     "Wrong leaves number");
+
+                    tree_type ret;
+                    typename tree_type::iterator it = ret.begin();
+                    while (first != last) {
+                        *it++ = crypto3::hash<hash_type>(*first++);
+                    }
+                    for (std::size_t row = 1; row < geometry_type::row_count; ++row) {
+                        const std::size_t children_begin = geometry_type::row_offsets[row - 1];
+                        const std::size_t row_begin = geometry_type::row_offsets[row];
+                        batch_node_hasher<hash_type, Arity>::process(ret.begin() + children_begin,
+                                                                     (row_begin - children_begin) / Arity,
+                                                                     ret.begin() + row_begin);
+                    }
+                    return ret;
+                }
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity, std::size_t LeafCount>
+            using fixed_merkle_tree =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_tree_fixed_impl<detail::merkle_tree_node<T>, Arity, LeafCount>,
+                                          detail::merkle_tree_fixed_impl<T, Arity, LeafCount>>::type;
+
+            template<typename T, std::size_t Arity, std::size_t LeafCount, typename LeafIterator>
+            fixed_merkle_tree<T, Arity, LeafCount> make_fixed_merkle_tree(LeafIterator first, LeafIterator last) {
+                return detail::make_fixed_merkle_tree<
+                    typename std::conditional<nil::crypto3::detail::is_hash<T>::value, detail::merkle_tree_node<T>,
+                                              T>::type,
+                    Arity, LeafCount>(first, last);
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_FIXED_TREE_HPP
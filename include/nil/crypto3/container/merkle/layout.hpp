@@ -0,0 +1,187 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+
+#ifndef CRYPTO3_MERKLE_LAYOUT_HPP
+#define CRYPTO3_MERKLE_LAYOUT_HPP
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+#include <nil/crypto3/container/merkle/batch_hasher.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Upper bound of the row count of any tree addressable with std::size_t.
+                constexpr const std::size_t merkle_tree_max_rows = std::numeric_limits<std::size_t>::digits + 1;
+
+                // Rows bottom-up, back to back: the original merkle_tree_impl layout.
+                template<std::size_t Arity>
+                class level_order_mapping {
+                public:
+                    level_order_mapping() : _row_offsets() {
+                    }
+
+                    explicit level_order_mapping(std::size_t leaves) : _row_offsets() {
+                        for (std::size_t row = 1, row_len = leaves; row_len > 1; ++row, row_len /= Arity) {
+                            _row_offsets[row] = _row_offsets[row - 1] + row_len;
+                        }
+                    }
+
+                    // Index in the storage of node 'pos' of row 'row', row 0 being the leaves.
+                    std::size_t index(std::size_t row, std::size_t pos) const {
+                        return _row_offsets[row] + pos;
+                    }
+
+                    // Number of nodes of row 'row' stored contiguously from node 'pos' on.
+                    std::size_t contiguous_run(std::size_t, std::size_t) const {
+                        return std::numeric_limits<std::size_t>::max();
+                    }
+
+                private:
+                    std::array<std::size_t, merkle_tree_max_rows> _row_offsets;
+                };
+
+                // Rows are cut bottom-up into bands of 'Levels' rows (the top band may be lower) and
+                // every band into subtrees of 'Levels' rows, each stored contiguously in level order
+                // from its root down. The bands follow each other leaves first. A leaf to root path
+                // then touches one subtree per band, i.e. 1 / Levels of the pages of the level-order
+                // layout.
+                template<std::size_t Arity, std::size_t Levels>
+                class subtree_blocked_mapping {
+                public:
+                    subtree_blocked_mapping() : _base(), _span(), _stride() {
+                    }
+
+                    explicit subtree_blocked_mapping(std::size_t leaves) : _base(), _span(), _stride() {
+                        std::size_t row_count = 1;
+                        for (std::size_t row_len = leaves; row_len > 1; row_len /= Arity) {
+                            ++row_count;
+                        }
+
+                        std::size_t band_base = 0, band_row_len = leaves;
+                        for (std::size_t band_bottom = 0; band_bottom < row_count; band_bottom += Levels) {
+                            const std::size_t band_top = std::min(band_bottom + Levels, row_count) - 1;
+                            // Number of nodes in a subtree of the band and in the rows above 'row' in it.
+                            std::size_t tile_size = 0, row_span = 1;
+                            for (std::size_t row = band_top + 1; row-- > band_bottom; row_span *= Arity) {
+                                _span[row] = row_span;
+                                _base[row] = band_base + tile_size;
+                                tile_size += row_span;
+                            }
+                            for (std::size_t row = band_bottom; row <= band_top; ++row) {
+                                _stride[row] = tile_size;
+                            }
+                            // 'band_row_len' subtrees have their leaves in the band bottom row.
+                            band_base += (band_row_len / _span[band_bottom]) * tile_size;
+                            for (std::size_t row = band_bottom; row <= band_top; ++row) {
+                                band_row_len /= Arity;
+                            }
+                        }
+                    }
+
+                    std::size_t index(std::size_t row, std::size_t pos) const {
+                        return _base[row] + (pos / _span[row]) * _stride[row] + pos % _span[row];
+                    }
+
+                    std::size_t contiguous_run(std::size_t row, std::size_t pos) const {
+                        return _span[row] - pos % _span[row];
+                    }
+
+                private:
+                    std::array<std::size_t, merkle_tree_max_rows> _base;
+                    std::array<std::size_t, merkle_tree_max_rows> _span;
+                    std::array<std::size_t, merkle_tree_max_rows> _stride;
+                };
+
+                // Hashes the groups [first_group, last_group) of row 'row - 1' of a tree stored at
+                // 'nodes' with 'mapping' into nodes of row 'row'. Runs the layout keeps contiguous go
+                // straight through batch_node_hasher, other groups are gathered first.
+                template<typename Hash, std::size_t Arity, typename Mapping, typename RandomAccessIterator>
+                void hash_merkle_row(RandomAccessIterator nodes, const Mapping &mapping, std::size_t row,
+                                     std::size_t first_group, std::size_t last_group) {
+                    typedef typename std::iterator_traits<RandomAccessIterator>::value_type value_type;
+
+                    std::vector<value_type> children, parents;
+                    while (first_group != last_group) {
+                        const std::size_t groups =
+                            std::min({mapping.contiguous_run(row - 1, first_group * Arity) / Arity,
+                                      mapping.contiguous_run(row, first_group), last_group - first_group});
+                        if (groups != 0) {
+                            batch_node_hasher<Hash, Arity>::process(nodes + mapping.index(row - 1, first_group * Arity),
+                                                                    groups, nodes + mapping.index(row, first_group));
+                            first_group += groups;
+                            continue;
+                        }
+
+                        const std::size_t gather_first = first_group;
+                        children.clear();
+                        for (; first_group != last_group &&
+                               mapping.contiguous_run(row - 1, first_group * Arity) < Arity;
+                             ++first_group) {
+                            for (std::size_t i = 0; i < Arity; ++i) {
+                                instrumented_emplace_back(children,
+                                                          nodes[mapping.index(row - 1, first_group * Arity + i)]);
+                            }
+                        }
+                        CRYPTO3_CONTAINERS_COUNT(allocation, parents.capacity() < first_group - gather_first);
+                        parents.resize(first_group - gather_first);
+                        batch_node_hasher<Hash, Arity>::process(children.begin(), parents.size(), parents.begin());
+                        for (std::size_t i = 0; i < parents.size(); ++i) {
+                            nodes[mapping.index(row, gather_first + i)] = parents[i];
+                        }
+                    }
+                }
+            }    // namespace detail
+
+            // Layout policies of merkle_tree_impl, mapping a node (row, position) to its index in
+            // the storage. Proofs and updates only go through that mapping, iterators walk the
+            // storage as is.
+            struct level_order_layout {
+                template<std::size_t Arity>
+                using mapping_type = detail::level_order_mapping<Arity>;
+            };
+
+            // See subtree_blocked_mapping. Levels = 4 keeps a binary subtree of SHA-256 hashes
+            // within 480 bytes, Levels = 7 within a 4 KiB page.
+            template<std::size_t Levels>
+            struct subtree_blocked_layout {
+                static_assert(Levels >= 1, "Subtrees must have at least one row");
+
+                template<std::size_t Arity>
+                using mapping_type = detail::subtree_blocked_mapping<Arity, Levels>;
+            };
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_LAYOUT_HPP
@@ -0,0 +1,241 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_LAZY_TREE_HPP
+#define CRYPTO3_MERKLE_LAZY_TREE_HPP
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/cached_tree.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Merkle tree that hashes its leaves and nothing else up front.
+                //
+                // Besides the leaf hashes it keeps a cap of the 'cap_rows' top rows, computed in one
+                // pass the first time the root or a cap node is requested, i.e. leaves() / Arity^k
+                // hashes for a cap starting at row k. Nodes between the leaves and the cap are folded
+                // from the leaves below them on demand and memoized in an LRU cache of at most
+                // 'cache_size' nodes, so trees opened around a few leaves only ever pay for the
+                // subtrees those proofs touch.
+                //
+                // The cap and the cache are filled from const member functions: concurrent reads of
+                // one tree must be synchronized by the caller.
+                template<typename NodeType, std::size_t Arity = 2, typename StoragePolicy = vector_storage>
+                class merkle_tree_lazy_impl {
+                public:
+                    typedef NodeType node_type;
+                    typedef StoragePolicy storage_policy_type;
+
+                    typedef typename node_type::hash_type hash_type;
+
+                    typedef typename node_type::value_type value_type;
+                    constexpr static const std::size_t value_bits = node_type::value_bits;
+
+                    typedef typename storage_policy_type::template container_type<value_type> container_type;
+
+                    typedef typename container_type::size_type size_type;
+
+                    merkle_tree_lazy_impl() : _leaves(0), _rc(0), _cap_row(0), _cache_size(0) {
+                    }
+
+                    // Takes over the hashes of 'leaf_hashes.size()' leaves.
+                    merkle_tree_lazy_impl(container_type &&leaf_hashes, size_t cap_rows, size_t cache_size) :
+                        _leaf_hashes(std::move(leaf_hashes)), _leaves(_leaf_hashes.size()),
+                        _rc(detail::merkle_tree_row_count(_leaves, Arity)), _cache_size(cache_size),
+                        _mapping(_leaves) {
+                        BOOST_ASSERT_MSG(detail::is_power_of(_leaves, Arity),
+                                         "Wrong leaves number, it must be a power of Arity.");
+                        // The cap holds the root at least and never the leaves.
+                        _cap_row =
+                            _rc - std::min(std::max<std::size_t>(cap_rows, 1), std::max<std::size_t>(_rc, 2) - 1);
+                    }
+
+                    size_t row_count() const {
+                        return _rc;
+                    }
+
+                    size_t leaves() const {
+                        return _leaves;
+                    }
+
+                    // Number of hashes of the complete tree.
+                    size_type complete_size() const {
+                        return detail::merkle_tree_length(_leaves, Arity);
+                    }
+
+                    // Lowest row of the cap.
+                    size_t cap_row() const {
+                        return _cap_row;
+                    }
+
+                    bool is_cap_materialized() const {
+                        return !_cap.empty();
+                    }
+
+                    size_t cache_size() const {
+                        return _cache_size;
+                    }
+
+                    // Number of memoized nodes below the cap.
+                    size_t cached_nodes() const {
+                        return _cache.size();
+                    }
+
+                    void clear_cache() const {
+                        _cache.clear();
+                        _lru.clear();
+                    }
+
+                    value_type root() const {
+                        return node(_rc - 1, 0);
+                    }
+
+                    // Node 'pos' of row 'row', row 0 being the leaves, computed if it is not kept yet.
+                    value_type node(size_t row, size_t pos) const {
+                        if (row == 0) {
+                            return _leaf_hashes[pos];
+                        }
+                        if (row >= _cap_row) {
+                            materialize_cap();
+                            return _cap[_mapping.index(row, pos) - _mapping.index(_cap_row, 0)];
+                        }
+
+                        const std::size_t key = _mapping.index(row, pos);
+                        typename cache_type::iterator it = _cache.find(key);
+                        if (it != _cache.end()) {
+                            _lru.splice(_lru.begin(), _lru, it->second);
+                            return it->second->second;
+                        }
+
+                        value_type x = fold_merkle_rows<hash_type, Arity>(
+                            _leaf_hashes.begin() + first_leaf(row, pos), row, _scratch);
+                        if (_cache_size != 0) {
+                            if (_lru.size() == _cache_size) {
+                                _cache.erase(_lru.back().first);
+                                _lru.pop_back();
+                            }
+                            _lru.emplace_front(key, x);
+                            _cache.emplace(key, _lru.begin());
+                        }
+                        return x;
+                    }
+
+                private:
+                    typedef std::list<std::pair<std::size_t, value_type>> lru_type;
+                    typedef std::unordered_map<std::size_t, typename lru_type::iterator> cache_type;
+
+                    static std::size_t first_leaf(std::size_t row, std::size_t pos) {
+                        for (std::size_t i = 0; i < row; ++i) {
+                            pos *= Arity;
+                        }
+                        return pos;
+                    }
+
+                    // The cap bottom row is folded subtree by subtree straight from the leaves, the
+                    // rows above it are hashed as usual.
+                    void materialize_cap() const {
+                        if (!_cap.empty()) {
+                            return;
+                        }
+                        const std::size_t cap_len = detail::merkle_tree_length(_leaves, Arity) -
+                                                    _mapping.index(_cap_row, 0);
+                        _cap.reserve(cap_len);
+                        const std::size_t slice_len = first_leaf(_cap_row, 1);
+                        for (std::size_t slice_begin = 0; slice_begin < _leaves; slice_begin += slice_len) {
+                            _cap.emplace_back(fold_merkle_rows<hash_type, Arity>(_leaf_hashes.begin() + slice_begin,
+                                                                                 _cap_row, _scratch));
+                        }
+                        for (std::size_t row_begin_idx = 0, row_len = _leaves / slice_len; row_len > 1;
+                             row_begin_idx += row_len, row_len /= Arity) {
+                            batch_node_hasher<hash_type, Arity>::process(_cap.begin() + row_begin_idx,
+                                                                         row_len / Arity, std::back_inserter(_cap));
+                        }
+                    }
+
+                    container_type _leaf_hashes;
+                    size_t _leaves;
+                    size_t _rc;
+                    size_t _cap_row;
+                    size_t _cache_size;
+                    level_order_mapping<Arity> _mapping;
+
+                    mutable std::vector<value_type> _cap;
+                    mutable lru_type _lru;
+                    mutable cache_type _cache;
+                    mutable std::vector<value_type> _scratch;
+                };
+
+                template<typename T, std::size_t Arity, typename StoragePolicy, typename LeafIterator>
+                merkle_tree_lazy_impl<T, Arity, StoragePolicy> make_lazy_merkle_tree(
+                    LeafIterator first, LeafIterator last, std::size_t cap_rows, std::size_t cache_size,
+                    typename merkle_tree_lazy_impl<T, Arity, StoragePolicy>::container_type &&storage) {
+                    typedef typename T::hash_type hash_type;
+
+                    storage.clear();
+                    storage.reserve(std::distance(first, last));
+                    while (first != last) {
+                        storage.emplace_back(crypto3::hash<hash_type>(*first++));
+                    }
+                    return merkle_tree_lazy_impl<T, Arity, StoragePolicy>(std::move(storage), cap_rows, cache_size);
+                }
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity, typename StoragePolicy = vector_storage>
+            using lazy_merkle_tree =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_tree_lazy_impl<detail::merkle_tree_node<T>, Arity, StoragePolicy>,
+                                          detail::merkle_tree_lazy_impl<T, Arity, StoragePolicy>>::type;
+
+            template<typename T, std::size_t Arity, typename StoragePolicy, typename LeafIterator>
+            lazy_merkle_tree<T, Arity, StoragePolicy>
+                make_lazy_merkle_tree(LeafIterator first, LeafIterator last, std::size_t cap_rows,
+                                      std::size_t cache_size,
+                                      typename lazy_merkle_tree<T, Arity, StoragePolicy>::container_type &&storage) {
+                return detail::make_lazy_merkle_tree<
+                    typename std::conditional<nil::crypto3::detail::is_hash<T>::value, detail::merkle_tree_node<T>,
+                                              T>::type,
+                    Arity, StoragePolicy>(first, last, cap_rows, cache_size, std::move(storage));
+            }
+
+            template<typename T, std::size_t Arity, typename LeafIterator>
+            lazy_merkle_tree<T, Arity> make_lazy_merkle_tree(LeafIterator first, LeafIterator last,
+                                                             std::size_t cap_rows, std::size_t cache_size) {
+                return make_lazy_merkle_tree<T, Arity, vector_storage>(
+                    first, last, cap_rows, cache_size, typename lazy_merkle_tree<T, Arity>::container_type());
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_LAZY_TREE_HPP
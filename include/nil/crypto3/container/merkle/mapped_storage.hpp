@@ -0,0 +1,387 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_MAPPED_STORAGE_HPP
+#define CRYPTO3_MERKLE_MAPPED_STORAGE_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include <boost/assert.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            enum class mapping_mode {
+                // Create (or truncate) the file and map it read-write.
+                create,
+                // Map an existing file read-write, its contents become the initial elements.
+                open,
+                // Map an existing file read-only; any modification is a precondition violation.
+                open_read_only
+            };
+
+            // A std::vector-like container whose elements live in a memory-mapped file.
+            //
+            // The file holds the raw element array and nothing else, so a container reopened
+            // over it has exactly the elements it was closed with, without any parsing. The
+            // file is grown geometrically while elements are appended and trimmed to size()
+            // elements when a writable container is destroyed.
+            template<typename T>
+            class mapped_vector {
+                static_assert(std::is_trivially_copyable<T>::value,
+                              "mapped_vector elements are stored as raw bytes and must be trivially copyable");
+
+            public:
+                typedef T value_type;
+                // Nominal, elements are never allocated through it.
+                typedef std::allocator<T> allocator_type;
+                typedef T &reference;
+                typedef const T &const_reference;
+                typedef std::size_t size_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef T *pointer;
+                typedef const T *const_pointer;
+                typedef T *iterator;
+                typedef const T *const_iterator;
+                typedef std::reverse_iterator<iterator> reverse_iterator;
+                typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+                mapped_vector() : _mode(mapping_mode::create), _data(nullptr), _size(0), _capacity(0) {
+                }
+
+                explicit mapped_vector(const std::string &path, mapping_mode mode = mapping_mode::create) :
+                    _path(path), _mode(mode), _data(nullptr), _size(0), _capacity(0) {
+                    if (mode == mapping_mode::create) {
+                        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                        if (!file) {
+                            throw std::runtime_error("mapped_vector: unable to create " + path);
+                        }
+                    } else {
+                        std::size_t bytes = boost::filesystem::file_size(path);
+                        if (bytes % sizeof(T) != 0) {
+                            throw std::runtime_error("mapped_vector: size of " + path +
+                                                     " is not a multiple of the element size");
+                        }
+                        map(bytes / sizeof(T));
+                        _size = _capacity;
+                    }
+                }
+
+                mapped_vector(const mapped_vector &) = delete;
+                mapped_vector &operator=(const mapped_vector &) = delete;
+
+                mapped_vector(mapped_vector &&x) BOOST_NOEXCEPT : _path(std::move(x._path)),
+                                                                  _mode(x._mode),
+                                                                  _region(std::move(x._region)),
+                                                                  _data(x._data),
+                                                                  _size(x._size),
+                                                                  _capacity(x._capacity) {
+                    x.release();
+                }
+
+                mapped_vector &operator=(mapped_vector &&x) BOOST_NOEXCEPT {
+                    if (this != &x) {
+                        close();
+                        _path = std::move(x._path);
+                        _mode = x._mode;
+                        _region = std::move(x._region);
+                        _data = x._data;
+                        _size = x._size;
+                        _capacity = x._capacity;
+                        x.release();
+                    }
+                    return *this;
+                }
+
+                ~mapped_vector() {
+                    close();
+                }
+
+                const std::string &path() const BOOST_NOEXCEPT {
+                    return _path;
+                }
+
+                bool operator==(const mapped_vector &rhs) const {
+                    return _size == rhs._size && std::equal(begin(), end(), rhs.begin());
+                }
+
+                bool operator!=(const mapped_vector &rhs) const {
+                    return !(*this == rhs);
+                }
+
+                allocator_type get_allocator() const BOOST_NOEXCEPT {
+                    return allocator_type();
+                }
+
+                iterator begin() BOOST_NOEXCEPT {
+                    return _data;
+                }
+
+                const_iterator begin() const BOOST_NOEXCEPT {
+                    return _data;
+                }
+
+                iterator end() BOOST_NOEXCEPT {
+                    return _data + _size;
+                }
+
+                const_iterator end() const BOOST_NOEXCEPT {
+                    return _data + _size;
+                }
+
+                reverse_iterator rbegin() BOOST_NOEXCEPT {
+                    return reverse_iterator(end());
+                }
+
+                const_reverse_iterator rbegin() const BOOST_NOEXCEPT {
+                    return const_reverse_iterator(end());
+                }
+
+                reverse_iterator rend() BOOST_NOEXCEPT {
+                    return reverse_iterator(begin());
+                }
+
+                const_reverse_iterator rend() const BOOST_NOEXCEPT {
+                    return const_reverse_iterator(begin());
+                }
+
+                size_type size() const BOOST_NOEXCEPT {
+                    return _size;
+                }
+
+                size_type capacity() const BOOST_NOEXCEPT {
+                    return _capacity;
+                }
+
+                bool empty() const BOOST_NOEXCEPT {
+                    return _size == 0;
+                }
+
+                size_type max_size() const BOOST_NOEXCEPT {
+                    return std::numeric_limits<size_type>::max() / sizeof(T);
+                }
+
+                void reserve(size_type n) {
+                    if (n > _capacity) {
+                        map(n);
+                    }
+                }
+
+                void shrink_to_fit() {
+                    if (_size != _capacity) {
+                        map(_size);
+                    }
+                }
+
+                reference operator[](size_type n) BOOST_NOEXCEPT {
+                    return _data[n];
+                }
+
+                const_reference operator[](size_type n) const BOOST_NOEXCEPT {
+                    return _data[n];
+                }
+
+                reference at(size_type n) {
+                    if (n >= _size) {
+                        throw std::out_of_range("mapped_vector::at");
+                    }
+                    return _data[n];
+                }
+
+                const_reference at(size_type n) const {
+                    if (n >= _size) {
+                        throw std::out_of_range("mapped_vector::at");
+                    }
+                    return _data[n];
+                }
+
+                reference front() BOOST_NOEXCEPT {
+                    return _data[0];
+                }
+
+                const_reference front() const BOOST_NOEXCEPT {
+                    return _data[0];
+                }
+
+                reference back() BOOST_NOEXCEPT {
+                    return _data[_size - 1];
+                }
+
+                const_reference back() const BOOST_NOEXCEPT {
+                    return _data[_size - 1];
+                }
+
+                pointer data() BOOST_NOEXCEPT {
+                    return _data;
+                }
+
+                const_pointer data() const BOOST_NOEXCEPT {
+                    return _data;
+                }
+
+                void push_back(const_reference x) {
+                    emplace_back(x);
+                }
+
+                void push_back(value_type &&x) {
+                    emplace_back(std::move(x));
+                }
+
+                template<class... Args>
+                reference emplace_back(Args &&...args) {
+                    if (_size == _capacity) {
+                        // The argument may alias an element, so construct it before remapping.
+                        value_type x(std::forward<Args>(args)...);
+                        grow(_size + 1);
+                        return *::new (static_cast<void *>(_data + _size++)) value_type(x);
+                    }
+                    return *::new (static_cast<void *>(_data + _size++)) value_type(std::forward<Args>(args)...);
+                }
+
+                template<class... Args>
+                iterator emplace(const_iterator position, Args &&...args) {
+                    const size_type idx = position - begin();
+                    value_type x(std::forward<Args>(args)...);
+                    grow(_size + 1);
+                    std::move_backward(_data + idx, _data + _size, _data + _size + 1);
+                    _data[idx] = x;
+                    ++_size;
+                    return _data + idx;
+                }
+
+                void pop_back() {
+                    --_size;
+                }
+
+                void clear() BOOST_NOEXCEPT {
+                    _size = 0;
+                }
+
+                void resize(size_type n) {
+                    resize(n, value_type());
+                }
+
+                void resize(size_type n, const_reference x) {
+                    if (n > _size) {
+                        const value_type v(x);
+                        grow(n);
+                        std::uninitialized_fill(_data + _size, _data + n, v);
+                    }
+                    _size = n;
+                }
+
+                void swap(mapped_vector &other) BOOST_NOEXCEPT {
+                    std::swap(_path, other._path);
+                    std::swap(_mode, other._mode);
+                    _region.swap(other._region);
+                    std::swap(_data, other._data);
+                    std::swap(_size, other._size);
+                    std::swap(_capacity, other._capacity);
+                }
+
+            private:
+                void grow(size_type n) {
+                    if (n > _capacity) {
+                        map(std::max(n, 2 * _capacity));
+                    }
+                }
+
+                // Resizes the backing file to 'n' elements and maps all of it.
+                void map(size_type n) {
+                    BOOST_ASSERT_MSG(!_path.empty(), "mapped_vector is not bound to a file");
+                    const bool writable = _mode != mapping_mode::open_read_only;
+                    BOOST_ASSERT_MSG(writable || n == _capacity || _capacity == 0,
+                                     "Read-only mapped_vector can not be resized");
+
+                    _region = boost::interprocess::mapped_region();
+                    _data = nullptr;
+                    if (writable) {
+                        boost::filesystem::resize_file(_path, n * sizeof(T));
+                    }
+                    if (n != 0) {
+                        const boost::interprocess::mode_t access =
+                            writable ? boost::interprocess::read_write : boost::interprocess::read_only;
+                        boost::interprocess::file_mapping file(_path.c_str(), access);
+                        _region = boost::interprocess::mapped_region(file, access, 0, n * sizeof(T));
+                        _data = static_cast<T *>(_region.get_address());
+                    }
+                    _capacity = n;
+                }
+
+                // Flushes the mapping and trims the file to the elements actually stored.
+                void close() BOOST_NOEXCEPT {
+                    if (_path.empty()) {
+                        return;
+                    }
+                    const bool writable = _mode != mapping_mode::open_read_only;
+                    if (writable && _data != nullptr) {
+                        _region.flush();
+                    }
+                    _region = boost::interprocess::mapped_region();
+                    _data = nullptr;
+                    if (writable && _size != _capacity) {
+                        boost::system::error_code ec;
+                        boost::filesystem::resize_file(_path, _size * sizeof(T), ec);
+                    }
+                    release();
+                }
+
+                void release() BOOST_NOEXCEPT {
+                    _path.clear();
+                    _data = nullptr;
+                    _size = 0;
+                    _capacity = 0;
+                }
+
+                std::string _path;
+                mapping_mode _mode;
+                boost::interprocess::mapped_region _region;
+                T *_data;
+                size_type _size;
+                size_type _capacity;
+            };
+
+            // Tree hashes in a memory-mapped file, see mapped_vector.
+            struct mapped_storage {
+                template<typename T>
+                using container_type = mapped_vector<T>;
+            };
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_MAPPED_STORAGE_HPP
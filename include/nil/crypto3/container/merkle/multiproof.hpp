@@ -0,0 +1,205 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+
+#ifndef CRYPTO3_MERKLE_MULTIPROOF_HPP
+#define CRYPTO3_MERKLE_MULTIPROOF_HPP
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Proof of several leaves against one root (the Octopus multiproof format).
+                //
+                // Only the nodes the verifier can not compute from the queried leaves themselves
+                // are stored, once each, row by row bottom-up and by ascending position inside a
+                // row. Their positions follow from the sorted leaf indices, so none are stored,
+                // and both the proof and the verifier state are O(queries * depth) whatever the
+                // tree width. Every node on the way is hashed exactly once by the verifier.
+                template<typename NodeType, std::size_t Arity = 2>
+                class merkle_multiproof_impl {
+                public:
+                    typedef NodeType node_type;
+                    typedef typename node_type::hash_type hash_type;
+
+                    constexpr static const std::size_t arity = Arity;
+
+                    constexpr static const std::size_t value_bits = node_type::value_bits;
+                    typedef typename node_type::value_type value_type;
+
+                    merkle_multiproof_impl() : _root(value_type()), _depth(0) {
+                    }
+
+                    // 'leaf_idxs' must be sorted and unique.
+                    merkle_multiproof_impl(std::vector<std::size_t> leaf_idxs, value_type root, std::size_t depth,
+                                           std::vector<value_type> siblings) :
+                        _leaf_idxs(std::move(leaf_idxs)),
+                        _root(root), _depth(depth), _siblings(std::move(siblings)) {
+                        BOOST_ASSERT_MSG(std::adjacent_find(_leaf_idxs.begin(), _leaf_idxs.end(),
+                                                            [](std::size_t a, std::size_t b) { return a >= b; }) ==
+                                             _leaf_idxs.end(),
+                                         "Leaf indices must be sorted and unique");
+                    }
+
+                    // Proof of the leaves [first, last) of 'tree', in any order and possibly repeated.
+                    template<typename TreeNodeType, typename StoragePolicy, typename Layout, typename IndexIterator>
+                    merkle_multiproof_impl(const merkle_tree_impl<TreeNodeType, Arity, StoragePolicy, Layout> &tree,
+                                           IndexIterator first, IndexIterator last) :
+                        _leaf_idxs(first, last),
+                        _root(tree.root()), _depth(tree.row_count() - 1) {
+                        std::sort(_leaf_idxs.begin(), _leaf_idxs.end());
+                        _leaf_idxs.erase(std::unique(_leaf_idxs.begin(), _leaf_idxs.end()), _leaf_idxs.end());
+                        BOOST_ASSERT_MSG(_leaf_idxs.empty() || _leaf_idxs.back() < tree.leaves(),
+                                         "Leaf index out of range");
+
+                        // Positions known to the verifier in the current row.
+                        std::vector<std::size_t> known(_leaf_idxs), parents;
+                        for (std::size_t row = 0; row < _depth; ++row) {
+                            parents.clear();
+                            for (typename std::vector<std::size_t>::const_iterator it = known.begin();
+                                 it != known.end();) {
+                                const std::size_t group = *it / Arity;
+                                for (std::size_t pos = group * Arity; pos < (group + 1) * Arity; ++pos) {
+                                    if (it != known.end() && *it == pos) {
+                                        ++it;
+                                    } else {
+                                        _siblings.emplace_back(tree.node(row, pos));
+                                    }
+                                }
+                                parents.emplace_back(group);
+                            }
+                            known.swap(parents);
+                        }
+                    }
+
+                    // Checks leaves [first, last), given in the order of leaf_indices().
+                    template<typename LeafIterator>
+                    bool validate(LeafIterator first, LeafIterator last) const {
+                        if (static_cast<std::size_t>(std::distance(first, last)) != _leaf_idxs.size() ||
+                            _leaf_idxs.empty()) {
+                            return false;
+                        }
+
+                        std::vector<std::pair<std::size_t, value_type>> known, parents;
+                        known.reserve(_leaf_idxs.size());
+                        for (std::size_t i = 0; first != last; ++i, ++first) {
+                            known.emplace_back(_leaf_idxs[i], crypto3::hash<hash_type>(*first));
+                        }
+
+                        typename std::vector<value_type>::const_iterator sibling = _siblings.begin();
+                        std::array<value_type, Arity> children;
+                        for (std::size_t row = 0; row < _depth; ++row) {
+                            parents.clear();
+                            for (typename std::vector<std::pair<std::size_t, value_type>>::const_iterator it =
+                                     known.begin();
+                                 it != known.end();) {
+                                const std::size_t group = it->first / Arity;
+                                for (std::size_t j = 0; j < Arity; ++j) {
+                                    if (it != known.end() && it->first == group * Arity + j) {
+                                        children[j] = (it++)->second;
+                                    } else if (sibling != _siblings.end()) {
+                                        children[j] = *sibling++;
+                                    } else {
+                                        return false;
+                                    }
+                                }
+                                parents.emplace_back(group, generate_hash<hash_type>(children.begin(), children.end()));
+                            }
+                            known.swap(parents);
+                        }
+                        return sibling == _siblings.end() && known.size() == 1 && known.front().first == 0 &&
+                               known.front().second == _root;
+                    }
+
+                    template<typename Hashable>
+                    bool validate(const std::vector<Hashable> &leaves) const {
+                        return validate(leaves.begin(), leaves.end());
+                    }
+
+                    // Sorted, unique indices of the proven leaves.
+                    const std::vector<std::size_t> &leaf_indices() const {
+                        return _leaf_idxs;
+                    }
+
+                    const value_type &root() const {
+                        return _root;
+                    }
+
+                    // Number of rows above the leaves, i.e. row_count() - 1 of the tree.
+                    std::size_t depth() const {
+                        return _depth;
+                    }
+
+                    const std::vector<value_type> &siblings() const {
+                        return _siblings;
+                    }
+
+                    bool operator==(const merkle_multiproof_impl &rhs) const {
+                        return _leaf_idxs == rhs._leaf_idxs && _root == rhs._root && _depth == rhs._depth &&
+                               _siblings == rhs._siblings;
+                    }
+                    bool operator!=(const merkle_multiproof_impl &rhs) const {
+                        return !(rhs == *this);
+                    }
+
+                private:
+                    std::vector<std::size_t> _leaf_idxs;
+                    value_type _root;
+                    std::size_t _depth;
+                    std::vector<value_type> _siblings;
+                };
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity>
+            using merkle_multiproof =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_multiproof_impl<detail::merkle_tree_node<T>, Arity>,
+                                          detail::merkle_multiproof_impl<T, Arity>>::type;
+
+            template<typename NodeType, std::size_t Arity, typename StoragePolicy, typename Layout, typename IndexIterator>
+            detail::merkle_multiproof_impl<NodeType, Arity>
+                generate_multiproof(const detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> &tree,
+                                    IndexIterator first, IndexIterator last) {
+                return detail::merkle_multiproof_impl<NodeType, Arity>(tree, first, last);
+            }
+
+            template<typename NodeType, std::size_t Arity, typename StoragePolicy, typename Layout>
+            detail::merkle_multiproof_impl<NodeType, Arity>
+                generate_multiproof(const detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> &tree,
+                                    const std::vector<std::size_t> &leaf_idxs) {
+                return generate_multiproof(tree, leaf_idxs.begin(), leaf_idxs.end());
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_MULTIPROOF_HPP
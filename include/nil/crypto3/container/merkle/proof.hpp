@@ -29,13 +29,21 @@
 #define CRYPTO3_MERKLE_PROOF_HPP
 
 #include <algorithm>
+#include <array>
+#include <memory>
 #include <vector>
 #include <stack>
+#include <utility>
 
 #include <boost/variant.hpp>
 
 #include <nil/crypto3/hash/type_traits.hpp>
+#include <nil/crypto3/container/detail/instrumentation.hpp>
 #include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/cached_tree.hpp>
+#include <nil/crypto3/container/merkle/lazy_tree.hpp>
+#include <nil/crypto3/container/merkle/fixed_tree.hpp>
+#include <nil/crypto3/container/merkle/tree_batch.hpp>
 
 namespace nil {
     namespace crypto3 {
@@ -53,7 +61,20 @@ namespace nil {
         }    // namespace marshalling
         namespace containers {
             namespace detail {
-                template<typename NodeType, std::size_t Arity = 2>
+                // Index among its Arity siblings of the path node of a proof layer. The sibling
+                // positions are those of the group less the path node, so it is what their sum
+                // misses, found without comparing them. Malformed layers yield some index in range.
+                template<std::size_t Arity, typename Layer>
+                std::size_t merkle_path_child_index(const Layer &layer) {
+                    std::size_t child = Arity * (Arity - 1) / 2;
+                    for (std::size_t i = 0; i < Arity - 1; ++i) {
+                        child -= layer[i]._position;
+                    }
+                    return std::min(child, Arity - 1);
+                }
+
+                // 'Allocator' is rebound to the layer type and used for the path.
+                template<typename NodeType, std::size_t Arity = 2, typename Allocator = std::allocator<void>>
                 class merkle_proof_impl {
                 public:
                     typedef NodeType node_type;
@@ -93,61 +114,88 @@ namespace nil {
                     };
 
                     typedef std::array<path_element_type, Arity - 1> layer_type;
-                    typedef std::vector<layer_type> path_type;
+                    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<layer_type> allocator_type;
+                    typedef std::vector<layer_type, allocator_type> path_type;
 
                     merkle_proof_impl() : _li(0), _root(value_type()) {};
 
                     merkle_proof_impl(std::size_t li, value_type root, path_type path) : _li(li), _root(root),
-                                                                                         _path(path){};
-
-                    merkle_proof_impl(const merkle_tree<hash_type, arity> &tree, const std::size_t leaf_idx) {
-                        _root = tree.root();
-                        _path.resize(tree.row_count() - 1);
-                        _li = leaf_idx;
-
-                        typename std::vector<layer_type>::iterator v_itr = _path.begin();
-                        std::size_t cur_leaf = leaf_idx;
-                        std::size_t row_len = tree.leaves();
-                        std::size_t row_begin_idx = 0;
-                        while (cur_leaf != tree.size() - 1) {    // while it's not _root
-                            std::size_t cur_leaf_pos = cur_leaf % arity;
-                            std::size_t cur_leaf_arity_pos = (cur_leaf - row_begin_idx) / arity;
-                            std::size_t begin_this_arity = cur_leaf - cur_leaf_pos;
-                            typename layer_type::iterator a_itr = v_itr->begin();
-                            for (size_t i = 0; i < cur_leaf_pos; ++i, ++begin_this_arity, ++a_itr) {
-                                *a_itr = path_element_type(tree[begin_this_arity], i);
-                            }
-                            for (size_t i = cur_leaf_pos + 1; i < arity; ++i, ++begin_this_arity, ++a_itr) {
-                                *a_itr = path_element_type(tree[begin_this_arity + 1], i);
-                            }
-                            v_itr++;
-                            cur_leaf = row_len + row_begin_idx + cur_leaf_arity_pos;
-                            row_begin_idx += row_len;
-                            row_len /= arity;
-                        }
+                                                                                         _path(std::move(path)){};
+
+                    template<typename TreeNodeType, typename StoragePolicy, typename Layout>
+                    merkle_proof_impl(const merkle_tree_impl<TreeNodeType, arity, StoragePolicy, Layout> &tree,
+                                      const std::size_t leaf_idx, const allocator_type &a = allocator_type()) :
+                        _li(leaf_idx),
+                        _root(tree.root()), _path(tree.row_count() - 1, a) {
+                        assign_path(tree);
+                    }
+
+                    template<typename TreeNodeType, std::size_t LeafCount>
+                    merkle_proof_impl(const merkle_tree_fixed_impl<TreeNodeType, arity, LeafCount> &tree,
+                                      const std::size_t leaf_idx, const allocator_type &a = allocator_type()) :
+                        _li(leaf_idx),
+                        _root(tree.root()), _path(tree.row_count() - 1, a) {
+                        assign_path(tree);
+                    }
+
+                    template<typename TreeNodeType>
+                    merkle_proof_impl(const merkle_tree_batch_view<TreeNodeType, arity> &tree,
+                                      const std::size_t leaf_idx, const allocator_type &a = allocator_type()) :
+                        _li(leaf_idx),
+                        _root(tree.root()), _path(tree.row_count() - 1, a) {
+                        assign_path(tree);
+                    }
+
+                    // Nodes of discarded rows are recomputed from the leaves under them.
+                    template<typename TreeNodeType, typename StoragePolicy>
+                    merkle_proof_impl(const merkle_tree_cached_impl<TreeNodeType, arity, StoragePolicy> &tree,
+                                      const std::size_t leaf_idx, const allocator_type &a = allocator_type()) :
+                        _li(leaf_idx),
+                        _root(tree.root()), _path(tree.row_count() - 1, a) {
+                        assign_path(tree);
+                    }
+
+                    // Nodes below the cap are computed, or taken from the tree cache, on the way.
+                    template<typename TreeNodeType, typename StoragePolicy>
+                    merkle_proof_impl(const merkle_tree_lazy_impl<TreeNodeType, arity, StoragePolicy> &tree,
+                                      const std::size_t leaf_idx, const allocator_type &a = allocator_type()) :
+                        _li(leaf_idx),
+                        _root(tree.root()), _path(tree.row_count() - 1, a) {
+                        assign_path(tree);
                     }
 
                     template<typename Hashable, typename HashType = typename NodeType::hash_type>
                     bool validate(const Hashable &a) const {
-                        using hash_type = typename NodeType::hash_type;
-                        value_type d = crypto3::hash<hash_type>(a);
-                        for (auto &it : _path) {
-                            accumulator_set<hash_type> acc;
-                            size_t i = 0;
-                            for (; (i < arity - 1) && i == it[i]._position; ++i) {
-                                crypto3::hash<hash_type>(it[i]._hash, acc);
-                            }
-                            crypto3::hash<hash_type>(d, acc);
-                            for (; i < arity - 1; ++i) {
-                                crypto3::hash<hash_type>(it[i]._hash, acc);
-                            }
-                            d = accumulators::extract::hash<hash_type>(acc);
+                        CRYPTO3_CONTAINERS_TIME_SCOPE(proof_validation);
+                        CRYPTO3_CONTAINERS_COUNT(accumulator_construction, 1);
+                        CRYPTO3_CONTAINERS_COUNT(hash_invocation, 1);
+                        return path_root(crypto3::hash<hash_type>(a), _path.begin(), _path.end()) == _root;
+                    }
+
+                    // Hashes the node 'd' up along the layers [first, last) and returns the resulting root.
+                    // Every parent goes through generate_hash, hence through the node hash of hash_type.
+                    template<typename LayerIterator>
+                    static value_type path_root(value_type d, LayerIterator first, LayerIterator last) {
+                        for (; first != last; ++first) {
+                            d = layer_parent(d, *first);
+                        }
+                        return d;
+                    }
+
+                    // Parent of the node 'd' of a path and of the siblings of 'layer'.
+                    static value_type layer_parent(const value_type &d, const layer_type &layer) {
+                        std::array<value_type, arity> children;
+                        const std::size_t child = merkle_path_child_index<arity>(layer);
+                        for (std::size_t i = 0; i < arity - 1; ++i) {
+                            children[merkle_path_iterator<arity>::sibling_index(i, child)] = layer[i]._hash;
                         }
-                        return (d == _root);
+                        children[child] = d;
+                        return generate_hash<hash_type>(children.begin(), children.end());
                     }
 
+                    template<typename StoragePolicy>
                     static std::vector<merkle_proof_impl>
-                        generate_compressed_proofs(const containers::merkle_tree<NodeType, Arity> &tree,
+                        generate_compressed_proofs(const merkle_tree_impl<NodeType, Arity, StoragePolicy> &tree,
                                                     std::vector<std::size_t> leaf_idxs) {
                         assert(leaf_idxs.size() > 0);
                         std::vector<std::size_t> sorted_idx(leaf_idxs.size());
@@ -155,9 +203,10 @@ namespace nil {
                         std::sort(sorted_idx.begin(), sorted_idx.end(), [&leaf_idxs](std::size_t i, std::size_t j) {
                                                                         return leaf_idxs[i] < leaf_idxs[j]; });
                         std::vector<merkle_proof_impl> result_proofs(leaf_idxs.size());
-                        std::size_t row_len = tree.leaves();
-                        std::vector<bool> known(2 * row_len, false);
+                        std::vector<bool> known(tree.size(), false);
                         std::size_t prev_leaf_idx = leaf_idxs[sorted_idx[0]] + 1;
+                        // Paths are collected here, every proof then gets a copy of its used layers only.
+                        path_type path(tree.row_count() - 1);
                         for (auto idx : sorted_idx) {
                             auto leaf_idx = leaf_idxs[idx];
                             if (leaf_idx == prev_leaf_idx) {
@@ -165,45 +214,20 @@ namespace nil {
                                 assert(result_proofs[idx].path().size() == 0);
                                 continue;
                             }
-                            path_type path(tree.row_count() - 1);
                             typename path_type::iterator path_itr = path.begin();
-                            std::size_t cur_leaf = leaf_idx;
-                            std::size_t row_len = tree.leaves();
-                            std::size_t row_begin_idx = 0;
                             bool finish_path = false;
-                            while (cur_leaf != tree.size() - 1) {
-                                std::size_t cur_leaf_pos = cur_leaf % Arity;
-                                std::size_t cur_leaf_arity_pos = (cur_leaf - row_begin_idx) / Arity;
-                                std::size_t begin_this_arity = cur_leaf - cur_leaf_pos;
-                                typename layer_type::iterator layer_itr = path_itr->begin();
-                                for (size_t i = 0; i < cur_leaf_pos; ++i, ++begin_this_arity) {
-                                    if (!known[begin_this_arity]) {
-                                        known[begin_this_arity] = true;
-                                    } else {
-                                        finish_path = true;
-                                    }
-                                    *layer_itr = path_element_type(tree[begin_this_arity], i);
-                                    ++layer_itr;
+                            // Stops after the first layer holding a sibling an earlier proof already has.
+                            for (merkle_path_iterator<Arity> it(leaf_idx); path_itr != path.end() && !finish_path;
+                                 ++it, ++path_itr) {
+                                for (std::size_t i = 0; i < Arity - 1; ++i) {
+                                    const std::size_t node_idx = tree.node_index(it.row(), it.sibling(i));
+                                    finish_path |= known[node_idx];
+                                    known[node_idx] = true;
+                                    (*path_itr)[i] = path_element_type(tree[node_idx], it.sibling_index(i));
                                 }
-                                for (size_t i = cur_leaf_pos + 1; i < Arity; ++i, ++begin_this_arity) {
-                                    if (!known[begin_this_arity + 1]) {
-                                        known[begin_this_arity + 1] = true;
-                                    } else {
-                                        finish_path = true;
-                                    }
-                                    *layer_itr = path_element_type(tree[begin_this_arity + 1], i);
-                                    ++layer_itr;
-                                }
-                                path_itr++;
-                                if (finish_path) {
-                                    break;
-                                }
-                                cur_leaf = row_len + row_begin_idx + cur_leaf_arity_pos;
-                                row_begin_idx += row_len;
-                                row_len /= Arity;
                             }
-                            path.resize(path_itr - path.begin());
-                            result_proofs[idx] = merkle_proof_impl(leaf_idx, tree.root(), path);
+                            result_proofs[idx] =
+                                merkle_proof_impl(leaf_idx, tree.root(), path_type(path.begin(), path_itr));
                             prev_leaf_idx = leaf_idx;
                         }
                         return result_proofs;
@@ -216,30 +240,31 @@ namespace nil {
                         assert(proofs.size() > 0);
                         std::vector<std::size_t> sorted_idx(proofs.size());
                         std::iota(sorted_idx.begin(), sorted_idx.end(), 0);
+                        // Leaves in descending order. A repeated leaf comes with an empty path, which has
+                        // to be met before the path of that leaf, so ties go by ascending path length.
                         std::sort(sorted_idx.begin(), sorted_idx.end(), [&proofs](std::size_t i, std::size_t j) {
-                                                                        return proofs[i].leaf_index() >= proofs[j].leaf_index(); });
+                            if (proofs[i].leaf_index() != proofs[j].leaf_index()) {
+                                return proofs[i].leaf_index() > proofs[j].leaf_index();
+                            }
+                            return proofs[i].path().size() < proofs[j].path().size();
+                        });
                         std::stack<std::pair<value_type, std::size_t>> st;
                         auto root = proofs[sorted_idx.back()].root();
                         auto full_proof_size = proofs[sorted_idx.back()].path().size();
+                        // nodes of the current path, one scratch vector reused across the proofs
+                        std::vector<value_type> hashes;
+                        hashes.reserve(full_proof_size + 1);
                         for (auto idx : sorted_idx) {
-                            auto path = proofs[idx].path();
+                            const auto &path = proofs[idx].path();
                             value_type d = crypto3::hash<hash_type>(a[idx]);
-                            std::vector<value_type> hashes = {d};
-                            for (auto &it : path) {
-                                accumulator_set<hash_type> acc;
-                                std::size_t i = 0;
-                                for (; (i < Arity - 1) && i == it[i].position(); ++i) {
-                                    crypto3::hash<hash_type>(it[i].hash(), acc);
-                                }
-                                crypto3::hash<hash_type>(d.begin(), d.end(), acc);
-                                for (; i < Arity - 1; ++i) {
-                                    crypto3::hash<hash_type>(it[i].hash(), acc);
-                                }
-                                d = accumulators::extract::hash<hash_type>(acc);
+                            hashes.clear();
+                            hashes.push_back(d);
+                            for (const auto &it : path) {
+                                d = layer_parent(d, it);
                                 hashes.push_back(d);
                             }
                             while (!st.empty()) {
-                                auto top = st.top();
+                                const auto &top = st.top();
                                 if (top.second >= hashes.size()) {
                                     break;
                                 }
@@ -277,7 +302,24 @@ namespace nil {
                         return _path;
                     }
 
+                    allocator_type get_allocator() const BOOST_NOEXCEPT {
+                        return _path.get_allocator();
+                    }
+
                 private:
+                    // Siblings of the path of leaf _li in every layer of _path.
+                    template<typename Tree>
+                    void assign_path(const Tree &tree) {
+                        merkle_path_iterator<arity> it(_li);
+                        for (typename path_type::iterator layer = _path.begin(); layer != _path.end();
+                             ++layer, ++it) {
+                            for (std::size_t i = 0; i < arity - 1; ++i) {
+                                (*layer)[i] =
+                                    path_element_type(tree.node(it.row(), it.sibling(i)), it.sibling_index(i));
+                            }
+                        }
+                    }
+
                     std::size_t _li;
                     value_type _root;
                     path_type _path;
@@ -292,11 +334,11 @@ namespace nil {
 
             }    // namespace detail
 
-            template<typename T, std::size_t Arity>
+            template<typename T, std::size_t Arity, typename Allocator = std::allocator<void>>
             using merkle_proof =
                 typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
-                                          detail::merkle_proof_impl<detail::merkle_tree_node<T>, Arity>,
-                                          detail::merkle_proof_impl<T, Arity>>::type;
+                                          detail::merkle_proof_impl<detail::merkle_tree_node<T>, Arity, Allocator>,
+                                          detail::merkle_proof_impl<T, Arity, Allocator>>::type;
 
         }    // namespace containers
     }        // namespace crypto3
@@ -0,0 +1,311 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_PROOF_BATCH_HPP
+#define CRYPTO3_MERKLE_PROOF_BATCH_HPP
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+#include <boost/range/iterator_range.hpp>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/proof.hpp>
+#include <nil/crypto3/container/detail/parallelization.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Full proofs for many leaves of one tree, stored in a single arena: the root once
+                // and row_count() - 1 layers per proof, back to back. Element 'i' is a lightweight
+                // view with the merkle_proof_impl interface; it converts to merkle_proof_impl when
+                // an owning proof is needed.
+                template<typename NodeType, std::size_t Arity = 2>
+                class merkle_proof_batch_impl {
+                public:
+                    typedef merkle_proof_impl<NodeType, Arity> proof_type;
+
+                    typedef typename proof_type::node_type node_type;
+                    typedef typename proof_type::hash_type hash_type;
+                    typedef typename proof_type::value_type value_type;
+                    typedef typename proof_type::layer_type layer_type;
+                    typedef typename proof_type::path_element_type path_element_type;
+                    typedef boost::iterator_range<const layer_type *> path_type;
+
+                    constexpr static const std::size_t arity = Arity;
+
+                    class proof_view {
+                    public:
+                        proof_view(const merkle_proof_batch_impl &batch, std::size_t idx) : _batch(&batch), _idx(idx) {
+                        }
+
+                        std::size_t leaf_index() const {
+                            return _batch->_leaf_idxs[_idx];
+                        }
+
+                        const value_type &root() const {
+                            return _batch->_root;
+                        }
+
+                        path_type path() const {
+                            const layer_type *first = _batch->_layers.data() + _idx * _batch->_depth;
+                            return path_type(first, first + _batch->_depth);
+                        }
+
+                        template<typename Hashable>
+                        bool validate(const Hashable &a) const {
+                            path_type p = path();
+                            return proof_type::path_root(crypto3::hash<hash_type>(a), p.begin(), p.end()) == root();
+                        }
+
+                        operator proof_type() const {
+                            path_type p = path();
+                            return proof_type(leaf_index(), root(), typename proof_type::path_type(p.begin(), p.end()));
+                        }
+
+                    private:
+                        const merkle_proof_batch_impl *_batch;
+                        std::size_t _idx;
+                    };
+
+                    merkle_proof_batch_impl() : _depth(0) {
+                    }
+
+                    // Proofs for the leaves [first, last). Proofs are split between up to 'threads'
+                    // threads; each thread walks its proofs row by row, so all of them read the same
+                    // tree row at a time.
+                    template<typename TreeNodeType, typename StoragePolicy, typename Layout, typename IndexIterator>
+                    merkle_proof_batch_impl(const merkle_tree_impl<TreeNodeType, Arity, StoragePolicy, Layout> &tree,
+                                            IndexIterator first, IndexIterator last, std::size_t threads = 1) :
+                        _leaf_idxs(first, last),
+                        _root(tree.root()), _depth(tree.row_count() - 1), _layers(_leaf_idxs.size() * _depth) {
+                        parallel_for(0, _leaf_idxs.size(), threads, [this, &tree](std::size_t begin, std::size_t end) {
+                            std::vector<merkle_path_iterator<Arity>> paths;
+                            paths.reserve(end - begin);
+                            for (std::size_t i = begin; i < end; ++i) {
+                                paths.emplace_back(_leaf_idxs[i]);
+                            }
+                            for (std::size_t row = 0; row < _depth; ++row) {
+                                for (std::size_t i = begin; i < end; ++i) {
+                                    merkle_path_iterator<Arity> &it = paths[i - begin];
+                                    layer_type &layer = _layers[i * _depth + row];
+                                    for (std::size_t j = 0; j < Arity - 1; ++j) {
+                                        layer[j] =
+                                            path_element_type(tree.node(row, it.sibling(j)), it.sibling_index(j));
+                                    }
+                                    ++it;
+                                }
+                            }
+                        });
+                    }
+
+                    std::size_t size() const {
+                        return _leaf_idxs.size();
+                    }
+
+                    bool empty() const {
+                        return _leaf_idxs.empty();
+                    }
+
+                    proof_view operator[](std::size_t idx) const {
+                        return proof_view(*this, idx);
+                    }
+
+                    const value_type &root() const {
+                        return _root;
+                    }
+
+                    // Layers of every proof, proof 'i' occupying [i * depth(), (i + 1) * depth()).
+                    const std::vector<layer_type> &layers() const {
+                        return _layers;
+                    }
+
+                    std::size_t depth() const {
+                        return _depth;
+                    }
+
+                private:
+                    std::vector<std::size_t> _leaf_idxs;
+                    value_type _root;
+                    std::size_t _depth;
+                    std::vector<layer_type> _layers;
+                };
+
+                // True if both proofs share the root and the path layers from 'row' upwards, so
+                // equal nodes at 'row' lead to the same result.
+                template<typename Proof>
+                bool same_proof_tail(const Proof &a, const Proof &b, std::size_t row) {
+                    const auto &a_path = a.path();
+                    const auto &b_path = b.path();
+                    return a.root() == b.root() && a_path.size() == b_path.size() &&
+                           std::equal(a_path.begin() + row, a_path.end(), b_path.begin() + row);
+                }
+
+                // Verifies proofs[order[i]] against leaves[order[i]] for every i in [first, last),
+                // 'order' sorting the proofs by leaf index. All proofs climb one row at a time, so
+                // each row is hashed by a single batch_node_hasher call. A proof whose node equals
+                // the node of its predecessor at the same row and whose remaining path is the same
+                // takes the predecessor's result instead of hashing the shared ancestors again.
+                template<typename Hash, std::size_t Arity, typename ValueType, typename Proofs,
+                         typename LeafIterator>
+                void validate_proofs_block(const Proofs &proofs, LeafIterator leaves, const std::size_t *first,
+                                           const std::size_t *last, char *results) {
+                    const std::size_t n = last - first;
+                    std::vector<ValueType> nodes, children, parents;
+                    std::vector<std::size_t> active, next_active, alias(n, n);
+                    nodes.reserve(n);
+                    active.reserve(n);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        nodes.emplace_back(crypto3::hash<Hash>(leaves[first[i]]));
+                        active.emplace_back(i);
+                    }
+
+                    for (std::size_t row = 0; !active.empty(); ++row) {
+                        children.clear();
+                        next_active.clear();
+                        std::size_t prev = n;
+                        for (std::size_t i : active) {
+                            const auto &proof = proofs[first[i]];
+                            const auto &path = proof.path();
+                            if (row >= static_cast<std::size_t>(path.size())) {
+                                continue;
+                            }
+                            if (prev != n && nodes[prev] == nodes[i] &&
+                                same_proof_tail(proofs[first[prev]], proof, row)) {
+                                alias[i] = prev;
+                                continue;
+                            }
+                            // Same child order as merkle_proof_impl::path_root.
+                            const auto &layer = path.begin()[row];
+                            const std::size_t group = children.size(), child = merkle_path_child_index<Arity>(layer);
+                            children.resize(group + Arity);
+                            for (std::size_t j = 0; j < Arity - 1; ++j) {
+                                children[group + merkle_path_iterator<Arity>::sibling_index(j, child)] = layer[j]._hash;
+                            }
+                            children[group + child] = nodes[i];
+                            next_active.emplace_back(i);
+                            prev = i;
+                        }
+                        parents.resize(next_active.size());
+                        batch_node_hasher<Hash, Arity>::process(children.begin(), next_active.size(), parents.begin());
+                        for (std::size_t j = 0; j < next_active.size(); ++j) {
+                            nodes[next_active[j]] = parents[j];
+                        }
+                        active.swap(next_active);
+                    }
+
+                    // Aliases always point to an earlier proof in 'order'.
+                    for (std::size_t i = 0; i < n; ++i) {
+                        results[first[i]] =
+                            alias[i] != n ? results[first[alias[i]]] : nodes[i] == proofs[first[i]].root();
+                    }
+                }
+
+                template<typename Hash, std::size_t Arity, typename ValueType, typename Proofs,
+                         typename LeafIterator, typename OutputIterator>
+                OutputIterator validate_proofs(const Proofs &proofs, std::size_t n, LeafIterator leaves,
+                                               OutputIterator out, std::size_t threads) {
+                    std::vector<std::size_t> order(n);
+                    std::iota(order.begin(), order.end(), 0);
+                    std::stable_sort(order.begin(), order.end(), [&proofs](std::size_t i, std::size_t j) {
+                        return proofs[i].leaf_index() < proofs[j].leaf_index();
+                    });
+
+                    std::vector<char> results(n);
+                    parallel_for(0, n, threads, [&](std::size_t begin, std::size_t end) {
+                        validate_proofs_block<Hash, Arity, ValueType>(proofs, leaves, order.data() + begin,
+                                                                      order.data() + end, results.data());
+                    });
+                    for (char result : results) {
+                        *out++ = result != 0;
+                    }
+                    return out;
+                }
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity>
+            using merkle_proof_batch =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_proof_batch_impl<detail::merkle_tree_node<T>, Arity>,
+                                          detail::merkle_proof_batch_impl<T, Arity>>::type;
+
+            template<typename NodeType, std::size_t Arity, typename StoragePolicy, typename Layout, typename IndexIterator>
+            detail::merkle_proof_batch_impl<NodeType, Arity>
+                generate_proofs(const detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> &tree,
+                                IndexIterator first, IndexIterator last, std::size_t threads = 1) {
+                return detail::merkle_proof_batch_impl<NodeType, Arity>(tree, first, last, threads);
+            }
+
+            template<typename NodeType, std::size_t Arity, typename StoragePolicy, typename Layout>
+            detail::merkle_proof_batch_impl<NodeType, Arity>
+                generate_proofs(const detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> &tree,
+                                const std::vector<std::size_t> &leaf_idxs, std::size_t threads = 1) {
+                return generate_proofs(tree, leaf_idxs.begin(), leaf_idxs.end(), threads);
+            }
+
+            // Verifies the proofs [first, last) against the leaves starting at 'leaves' (random
+            // access, one per proof) and writes one bool per proof to 'out', in input order.
+            // Proofs may belong to different trees; shared ancestors are only hashed once.
+            template<typename ProofIterator, typename LeafIterator, typename OutputIterator>
+            OutputIterator validate_proofs(ProofIterator first, ProofIterator last, LeafIterator leaves,
+                                           OutputIterator out, std::size_t threads = 1) {
+                typedef typename std::iterator_traits<ProofIterator>::value_type proof_type;
+                return detail::validate_proofs<typename proof_type::hash_type, proof_type::arity,
+                                               typename proof_type::value_type>(first, std::distance(first, last),
+                                                                                leaves, out, threads);
+            }
+
+            template<typename NodeType, std::size_t Arity, typename LeafIterator, typename OutputIterator>
+            OutputIterator validate_proofs(const detail::merkle_proof_batch_impl<NodeType, Arity> &proofs,
+                                           LeafIterator leaves, OutputIterator out, std::size_t threads = 1) {
+                typedef detail::merkle_proof_batch_impl<NodeType, Arity> batch_type;
+                return detail::validate_proofs<typename batch_type::hash_type, Arity, typename batch_type::value_type>(
+                    proofs, proofs.size(), leaves, out, threads);
+            }
+
+            // True if every proof of [first, last) is valid for its leaf.
+            template<typename ProofIterator, typename LeafIterator>
+            bool validate_all_proofs(ProofIterator first, ProofIterator last, LeafIterator leaves,
+                                     std::size_t threads = 1) {
+                std::vector<char> results(std::distance(first, last));
+                validate_proofs(first, last, leaves, results.begin(), threads);
+                return std::find(results.begin(), results.end(), 0) == results.end();
+            }
+
+            template<typename NodeType, std::size_t Arity, typename LeafIterator>
+            bool validate_all_proofs(const detail::merkle_proof_batch_impl<NodeType, Arity> &proofs,
+                                     LeafIterator leaves, std::size_t threads = 1) {
+                std::vector<char> results(proofs.size());
+                validate_proofs(proofs, leaves, results.begin(), threads);
+                return std::find(results.begin(), results.end(), 0) == results.end();
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_PROOF_BATCH_HPP
@@ -0,0 +1,453 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_SERIALIZATION_HPP
+#define CRYPTO3_MERKLE_SERIALIZATION_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+#include <nil/crypto3/container/detail/instrumentation.hpp>
+#include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/proof.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            // Flat binary format of trees and proofs.
+            //
+            // A 32-byte header, all integers little-endian:
+            //   magic      4 bytes, "MKLT" for a tree, "MKLP" for a proof
+            //   version    uint32, merkle_serialization_version
+            //   arity      uint32
+            //   value size uint32, bytes per digest
+            //   count      uint64, number of leaves of a tree, leaf index of a proof
+            //   rows       uint64, row count of a tree, number of path layers of a proof
+            // followed by raw digests: the rows of a tree bottom-up, each from its first node on,
+            // whatever the layout of the tree in memory; the root of a proof, then the Arity - 1
+            // siblings of every layer from the leaf up, in row order. Sibling positions follow
+            // from the leaf index and are not stored.
+            constexpr const std::uint32_t merkle_serialization_version = 1;
+
+            namespace detail {
+                constexpr const std::size_t merkle_serialization_header_size = 32;
+
+                struct merkle_serialization_header {
+                    std::array<char, 4> magic;
+                    std::uint32_t version;
+                    std::uint32_t arity;
+                    std::uint32_t value_size;
+                    std::uint64_t count;
+                    std::uint64_t rows;
+
+                    template<typename UInt>
+                    static std::uint8_t *store(UInt x, std::uint8_t *out) {
+                        for (std::size_t i = 0; i < sizeof(UInt); ++i, x >>= 8) {
+                            *out++ = static_cast<std::uint8_t>(x & 0xFF);
+                        }
+                        return out;
+                    }
+
+                    template<typename UInt>
+                    static const std::uint8_t *load(UInt &x, const std::uint8_t *in) {
+                        x = 0;
+                        for (std::size_t i = sizeof(UInt); i-- > 0;) {
+                            x = static_cast<UInt>((x << 8) | in[i]);
+                        }
+                        return in + sizeof(UInt);
+                    }
+
+                    std::uint8_t *write(std::uint8_t *out) const {
+                        out = std::copy(magic.begin(), magic.end(), out);
+                        out = store(version, out);
+                        out = store(arity, out);
+                        out = store(value_size, out);
+                        out = store(count, out);
+                        return store(rows, out);
+                    }
+
+                    // Reads and checks everything but the counts, which depend on the kind of object.
+                    static merkle_serialization_header read(const std::uint8_t *data, std::size_t size,
+                                                            const std::array<char, 4> &magic, std::size_t arity,
+                                                            std::size_t value_size) {
+                        if (size < merkle_serialization_header_size) {
+                            throw std::invalid_argument("merkle serialization: truncated header");
+                        }
+                        merkle_serialization_header h;
+                        std::copy(data, data + 4, h.magic.begin());
+                        const std::uint8_t *in = data + 4;
+                        in = load(h.version, in);
+                        in = load(h.arity, in);
+                        in = load(h.value_size, in);
+                        in = load(h.count, in);
+                        load(h.rows, in);
+                        if (h.magic != magic) {
+                            throw std::invalid_argument("merkle serialization: bad magic");
+                        }
+                        if (h.version != merkle_serialization_version) {
+                            throw std::invalid_argument("merkle serialization: unsupported version");
+                        }
+                        if (h.arity != arity || h.value_size != value_size) {
+                            throw std::invalid_argument("merkle serialization: arity or digest size mismatch");
+                        }
+                        return h;
+                    }
+                };
+
+                constexpr const std::array<char, 4> merkle_tree_magic = {{'M', 'K', 'L', 'T'}};
+                constexpr const std::array<char, 4> merkle_proof_magic = {{'M', 'K', 'L', 'P'}};
+
+                // Digests are copied as raw bytes and read in place from buffers of any alignment.
+                template<typename ValueType>
+                struct is_flat_serializable
+                    : std::integral_constant<bool, std::is_trivially_copyable<ValueType>::value &&
+                                                       alignof(ValueType) == 1> { };
+
+                // Non-owning view of a tree serialized by serialize(), e.g. in a network buffer or a
+                // mapped file. Nothing is copied or parsed beyond the header, which is checked on
+                // construction; the buffer must outlive the view.
+                template<typename NodeType, std::size_t Arity = 2>
+                class merkle_tree_view_impl {
+                public:
+                    typedef NodeType node_type;
+                    typedef typename node_type::hash_type hash_type;
+                    typedef typename node_type::value_type value_type;
+                    typedef const value_type *const_iterator;
+
+                    constexpr static const std::size_t arity = Arity;
+
+                    static_assert(is_flat_serializable<value_type>::value,
+                                  "Flat serialization needs byte-aligned, trivially copyable digests");
+
+                    merkle_tree_view_impl() : _nodes(nullptr), _leaves(0), _rc(0), _size(0) {
+                    }
+
+                    // Throws std::invalid_argument unless [data, data + size) holds exactly one tree.
+                    merkle_tree_view_impl(const std::uint8_t *data, std::size_t size) {
+                        const merkle_serialization_header h = merkle_serialization_header::read(
+                            data, size, merkle_tree_magic, Arity, sizeof(value_type));
+                        const std::size_t capacity = (size - merkle_serialization_header_size) / sizeof(value_type);
+                        if (h.count > capacity || (h.count == 0 ? h.rows != 0 : !is_power_of(h.count, Arity)) ||
+                            (h.count != 0 && h.rows != merkle_tree_row_count(h.count, Arity))) {
+                            throw std::invalid_argument("merkle serialization: inconsistent tree geometry");
+                        }
+                        _leaves = h.count;
+                        _rc = h.rows;
+                        _size = merkle_tree_length(_leaves, Arity);
+                        if (size != merkle_serialization_header_size + _size * sizeof(value_type)) {
+                            throw std::invalid_argument("merkle serialization: tree size mismatch");
+                        }
+                        _nodes = reinterpret_cast<const value_type *>(data + merkle_serialization_header_size);
+                        _mapping = level_order_mapping<Arity>(_leaves);
+                    }
+
+                    std::size_t leaves() const {
+                        return _leaves;
+                    }
+
+                    std::size_t row_count() const {
+                        return _rc;
+                    }
+
+                    std::size_t size() const {
+                        return _size;
+                    }
+
+                    const value_type &node(std::size_t row, std::size_t pos) const {
+                        return _nodes[_mapping.index(row, pos)];
+                    }
+
+                    const value_type &root() const {
+                        BOOST_ASSERT_MSG(_rc > 0, "Empty tree has no root");
+                        return node(_rc - 1, 0);
+                    }
+
+                    // All nodes in level order, i.e. as merkle_tree_impl with level_order_layout stores them.
+                    const_iterator begin() const {
+                        return _nodes;
+                    }
+
+                    const_iterator end() const {
+                        return _nodes + _size;
+                    }
+
+                private:
+                    const value_type *_nodes;
+                    std::size_t _leaves;
+                    std::size_t _rc;
+                    std::size_t _size;
+                    level_order_mapping<Arity> _mapping;
+                };
+
+                // Non-owning view of a proof serialized by serialize(), validated in place.
+                template<typename NodeType, std::size_t Arity = 2>
+                class merkle_proof_view_impl {
+                public:
+                    typedef NodeType node_type;
+                    typedef typename node_type::hash_type hash_type;
+                    typedef typename node_type::value_type value_type;
+
+                    constexpr static const std::size_t arity = Arity;
+
+                    static_assert(is_flat_serializable<value_type>::value,
+                                  "Flat serialization needs byte-aligned, trivially copyable digests");
+
+                    merkle_proof_view_impl() : _nodes(nullptr), _li(0), _depth(0) {
+                    }
+
+                    // Throws std::invalid_argument unless [data, data + size) holds exactly one proof.
+                    merkle_proof_view_impl(const std::uint8_t *data, std::size_t size) {
+                        const merkle_serialization_header h = merkle_serialization_header::read(
+                            data, size, merkle_proof_magic, Arity, sizeof(value_type));
+                        const std::size_t capacity = (size - merkle_serialization_header_size) / sizeof(value_type);
+                        if (capacity == 0 || h.rows > (capacity - 1) / (Arity - 1) ||
+                            size != merkle_serialization_header_size +
+                                        (1 + h.rows * (Arity - 1)) * sizeof(value_type)) {
+                            throw std::invalid_argument("merkle serialization: proof size mismatch");
+                        }
+                        // The leaf index must be below Arity^rows; dividing it avoids overflowing the power.
+                        std::uint64_t high_digits = h.count;
+                        for (std::uint64_t row = 0; row < h.rows && high_digits != 0; ++row) {
+                            high_digits /= Arity;
+                        }
+                        if (high_digits != 0) {
+                            throw std::invalid_argument("merkle serialization: leaf index out of range");
+                        }
+                        _li = h.count;
+                        _depth = h.rows;
+                        _nodes = reinterpret_cast<const value_type *>(data + merkle_serialization_header_size);
+                    }
+
+                    std::size_t leaf_index() const {
+                        return _li;
+                    }
+
+                    // Number of path layers.
+                    std::size_t depth() const {
+                        return _depth;
+                    }
+
+                    const value_type &root() const {
+                        return _nodes[0];
+                    }
+
+                    // Sibling 'i' of layer 'layer', 0 <= i < Arity - 1, in row order.
+                    const value_type &sibling(std::size_t layer, std::size_t i) const {
+                        return _nodes[1 + layer * (Arity - 1) + i];
+                    }
+
+                    // Position among its Arity siblings of the path node of layer 'layer'.
+                    std::size_t position(std::size_t layer) const {
+                        std::size_t idx = _li;
+                        for (std::size_t i = 0; i < layer; ++i) {
+                            idx = merkle_tree_arity<Arity>::parent(idx);
+                        }
+                        return merkle_tree_arity<Arity>::child_index(idx);
+                    }
+
+                    template<typename Hashable>
+                    bool validate(const Hashable &a) const {
+                        CRYPTO3_CONTAINERS_TIME_SCOPE(proof_validation);
+                        CRYPTO3_CONTAINERS_COUNT(accumulator_construction, 1);
+                        CRYPTO3_CONTAINERS_COUNT(hash_invocation, 1);
+                        value_type d = crypto3::hash<hash_type>(a);
+                        std::array<value_type, Arity> children;
+                        for (merkle_path_iterator<Arity> it(_li); it.row() < _depth; ++it) {
+                            for (std::size_t i = 0; i < Arity - 1; ++i) {
+                                children[it.sibling_index(i)] = sibling(it.row(), i);
+                            }
+                            children[it.child_index()] = d;
+                            d = generate_hash<hash_type>(children.begin(), children.end());
+                        }
+                        return d == root();
+                    }
+
+                private:
+                    const value_type *_nodes;
+                    std::size_t _li;
+                    std::size_t _depth;
+                };
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity>
+            using merkle_tree_view =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_tree_view_impl<detail::merkle_tree_node<T>, Arity>,
+                                          detail::merkle_tree_view_impl<T, Arity>>::type;
+
+            template<typename T, std::size_t Arity>
+            using merkle_proof_view =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_proof_view_impl<detail::merkle_tree_node<T>, Arity>,
+                                          detail::merkle_proof_view_impl<T, Arity>>::type;
+
+            template<typename NodeType, std::size_t Arity, typename StoragePolicy, typename Layout>
+            std::size_t serialized_size(const detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> &tree) {
+                return detail::merkle_serialization_header_size +
+                       detail::merkle_tree_length(tree.leaves(), Arity) * sizeof(typename NodeType::value_type);
+            }
+
+            // Writes serialized_size(tree) bytes at 'out' and returns the end of them. Runs of nodes the
+            // layout keeps contiguous are copied at once, a whole row at a time for the default layout.
+            template<typename NodeType, std::size_t Arity, typename StoragePolicy, typename Layout>
+            std::uint8_t *serialize(const detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> &tree,
+                                    std::uint8_t *out) {
+                typedef detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> tree_type;
+                typedef typename tree_type::value_type value_type;
+                static_assert(detail::is_flat_serializable<value_type>::value,
+                              "Flat serialization needs byte-aligned, trivially copyable digests");
+
+                const detail::merkle_serialization_header h = {detail::merkle_tree_magic,
+                                                               merkle_serialization_version,
+                                                               static_cast<std::uint32_t>(Arity),
+                                                               static_cast<std::uint32_t>(sizeof(value_type)),
+                                                               tree.leaves(),
+                                                               tree.row_count()};
+                out = h.write(out);
+
+                const typename tree_type::mapping_type mapping(tree.leaves());
+                for (std::size_t row = 0, row_len = tree.leaves(); row_len > 0; ++row, row_len /= Arity) {
+                    for (std::size_t pos = 0; pos < row_len;) {
+                        const std::size_t run = std::min(mapping.contiguous_run(row, pos), row_len - pos);
+                        std::memcpy(out, tree.hashes() + mapping.index(row, pos), run * sizeof(value_type));
+                        out += run * sizeof(value_type);
+                        pos += run;
+                    }
+                }
+                return out;
+            }
+
+            template<typename NodeType, std::size_t Arity, typename StoragePolicy, typename Layout>
+            std::vector<std::uint8_t>
+                serialize(const detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> &tree) {
+                std::vector<std::uint8_t> result(serialized_size(tree));
+                serialize(tree, result.data());
+                return result;
+            }
+
+            template<typename NodeType, std::size_t Arity, typename Allocator>
+            std::size_t serialized_size(const detail::merkle_proof_impl<NodeType, Arity, Allocator> &proof) {
+                return detail::merkle_serialization_header_size +
+                       (1 + proof.path().size() * (Arity - 1)) * sizeof(typename NodeType::value_type);
+            }
+
+            template<typename NodeType, std::size_t Arity, typename Allocator>
+            std::uint8_t *serialize(const detail::merkle_proof_impl<NodeType, Arity, Allocator> &proof,
+                                    std::uint8_t *out) {
+                typedef typename detail::merkle_proof_impl<NodeType, Arity, Allocator>::value_type value_type;
+                static_assert(detail::is_flat_serializable<value_type>::value,
+                              "Flat serialization needs byte-aligned, trivially copyable digests");
+
+                const detail::merkle_serialization_header h = {detail::merkle_proof_magic,
+                                                               merkle_serialization_version,
+                                                               static_cast<std::uint32_t>(Arity),
+                                                               static_cast<std::uint32_t>(sizeof(value_type)),
+                                                               proof.leaf_index(),
+                                                               proof.path().size()};
+                out = h.write(out);
+                std::memcpy(out, &proof.root(), sizeof(value_type));
+                out += sizeof(value_type);
+                for (const auto &layer : proof.path()) {
+                    for (const auto &element : layer) {
+                        std::memcpy(out, &element.hash(), sizeof(value_type));
+                        out += sizeof(value_type);
+                    }
+                }
+                return out;
+            }
+
+            template<typename NodeType, std::size_t Arity, typename Allocator>
+            std::vector<std::uint8_t> serialize(const detail::merkle_proof_impl<NodeType, Arity, Allocator> &proof) {
+                std::vector<std::uint8_t> result(serialized_size(proof));
+                serialize(proof, result.data());
+                return result;
+            }
+
+            // Owning copies of serialized objects, in any storage and layout.
+            template<typename StoragePolicy = vector_storage, typename Layout = level_order_layout,
+                     typename NodeType, std::size_t Arity>
+            detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout>
+                load_merkle_tree(const detail::merkle_tree_view_impl<NodeType, Arity> &view,
+                                 typename detail::merkle_tree_impl<NodeType, Arity, StoragePolicy,
+                                                                   Layout>::container_type &&storage = {}) {
+                typedef detail::merkle_tree_impl<NodeType, Arity, StoragePolicy, Layout> tree_type;
+                typedef typename tree_type::value_type value_type;
+
+                storage.resize(view.size());
+                const typename tree_type::mapping_type mapping(view.leaves());
+                for (std::size_t row = 0, row_len = view.leaves(); row_len > 0; ++row, row_len /= Arity) {
+                    for (std::size_t pos = 0; pos < row_len;) {
+                        const std::size_t run = std::min(mapping.contiguous_run(row, pos), row_len - pos);
+                        std::memcpy(storage.data() + mapping.index(row, pos), &view.node(row, pos),
+                                    run * sizeof(value_type));
+                        pos += run;
+                    }
+                }
+                return tree_type(std::move(storage), view.leaves());
+            }
+
+            template<typename NodeType, std::size_t Arity>
+            detail::merkle_proof_impl<NodeType, Arity>
+                load_merkle_proof(const detail::merkle_proof_view_impl<NodeType, Arity> &view) {
+                typedef detail::merkle_proof_impl<NodeType, Arity> proof_type;
+
+                typename proof_type::path_type path(view.depth());
+                for (detail::merkle_path_iterator<Arity> it(view.leaf_index()); it.row() < view.depth(); ++it) {
+                    for (std::size_t i = 0; i < Arity - 1; ++i) {
+                        path[it.row()][i] =
+                            typename proof_type::path_element_type(view.sibling(it.row(), i), it.sibling_index(i));
+                    }
+                }
+                return proof_type(view.leaf_index(), view.root(), path);
+            }
+
+            // Proof of leaf 'leaf_idx' read straight from a serialized tree.
+            template<typename NodeType, std::size_t Arity>
+            detail::merkle_proof_impl<NodeType, Arity>
+                generate_proof(const detail::merkle_tree_view_impl<NodeType, Arity> &view, std::size_t leaf_idx) {
+                typedef detail::merkle_proof_impl<NodeType, Arity> proof_type;
+                BOOST_ASSERT_MSG(leaf_idx < view.leaves(), "Leaf index out of range");
+
+                typename proof_type::path_type path(view.row_count() - 1);
+                for (detail::merkle_path_iterator<Arity> it(leaf_idx); it.row() < path.size(); ++it) {
+                    for (std::size_t i = 0; i < Arity - 1; ++i) {
+                        path[it.row()][i] = typename proof_type::path_element_type(view.node(it.row(), it.sibling(i)),
+                                                                                   it.sibling_index(i));
+                    }
+                }
+                return proof_type(leaf_idx, view.root(), path);
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_SERIALIZATION_HPP
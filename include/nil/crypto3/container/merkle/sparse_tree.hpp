@@ -0,0 +1,290 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+
+#ifndef CRYPTO3_MERKLE_SPARSE_TREE_HPP
+#define CRYPTO3_MERKLE_SPARSE_TREE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/proof.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                // Binary merkle tree over a 2^Depth key space of which only a few leaves are set.
+                //
+                // Unset leaves hold the empty leaf value, value_type(), so every subtree without
+                // a set leaf has the precomputed hash of its level and is not stored; only nodes
+                // of non-empty subtrees live in a hash map keyed by (level, key prefix). Keys are
+                // Depth-bit numbers, big-endian; bit 'l' selects the child at level 'l', level 0
+                // being the leaves. Proofs have the merkle_proof shape, so they also authenticate
+                // empty leaves (non-membership).
+                template<typename NodeType, std::size_t Depth>
+                class sparse_merkle_tree_impl {
+                public:
+                    typedef NodeType node_type;
+                    typedef typename node_type::hash_type hash_type;
+
+                    typedef typename node_type::value_type value_type;
+                    constexpr static const std::size_t value_bits = node_type::value_bits;
+
+                    constexpr static const std::size_t depth = Depth;
+
+                    typedef std::array<std::uint8_t, (Depth + 7) / 8> key_type;
+                    typedef merkle_proof_impl<NodeType, 2> proof_type;
+
+                    sparse_merkle_tree_impl() : _leaves(0) {
+                        _empty_hashes[0] = empty_leaf();
+                        std::array<value_type, 2> children;
+                        for (std::size_t level = 0; level < Depth; ++level) {
+                            children.fill(_empty_hashes[level]);
+                            _empty_hashes[level + 1] = generate_hash<hash_type>(children.begin(), children.end());
+                        }
+                    }
+
+                    // Key of the leaf number 'idx'.
+                    static key_type make_key(std::uint64_t idx) {
+                        key_type key {};
+                        for (std::size_t i = key.size(); i-- > 0 && idx != 0; idx >>= 8) {
+                            key[i] = static_cast<std::uint8_t>(idx);
+                        }
+                        return key;
+                    }
+
+                    static value_type empty_leaf() {
+                        return value_type();
+                    }
+
+                    // Hash of a subtree of height 'level' without set leaves.
+                    const value_type &empty_hash(std::size_t level) const {
+                        return _empty_hashes[level];
+                    }
+
+                    value_type root() const {
+                        return node(Depth, key_type {});
+                    }
+
+                    // Node of level 'level' above the leaf 'key'.
+                    value_type node(std::size_t level, key_type key) const {
+                        clear_low_bits(key, level);
+                        typename nodes_type::const_iterator it = _nodes.find(node_key_type(level, key));
+                        return it == _nodes.end() ? _empty_hashes[level] : it->second;
+                    }
+
+                    bool contains(const key_type &key) const {
+                        return _nodes.count(node_key_type(0, key)) != 0;
+                    }
+
+                    // Number of set leaves.
+                    std::size_t leaves() const {
+                        return _leaves;
+                    }
+
+                    // Number of stored nodes, leaves included.
+                    std::size_t size() const {
+                        return _nodes.size();
+                    }
+
+                    template<typename Hashable>
+                    void insert(const key_type &key, const Hashable &leaf) {
+                        std::pair<key_type, Hashable> update(key, leaf);
+                        insert(&update, &update + 1);
+                    }
+
+                    // Inserts or replaces a batch of (key, leaf) pairs, later pairs win on repeated
+                    // keys. Every node above the changed leaves is rehashed once.
+                    template<typename InputIterator>
+                    void insert(InputIterator first, InputIterator last) {
+                        std::vector<key_type> dirty;
+                        for (; first != last; ++first) {
+                            set_node(0, first->first, crypto3::hash<hash_type>(first->second));
+                            dirty.emplace_back(first->first);
+                        }
+                        rehash(dirty);
+                    }
+
+                    void erase(const key_type &key) {
+                        erase(&key, &key + 1);
+                    }
+
+                    // Resets the leaves [first, last), given by key, to the empty leaf.
+                    template<typename KeyIterator>
+                    void erase(KeyIterator first, KeyIterator last) {
+                        std::vector<key_type> dirty(first, last);
+                        for (const key_type &key : dirty) {
+                            set_node(0, key, empty_leaf());
+                        }
+                        rehash(dirty);
+                    }
+
+                    // Path of the leaf 'key', set or not. std::size_t leaf indices can not hold
+                    // every key, so the proof leaf index is the key modulo 2^64.
+                    proof_type proof(const key_type &key) const {
+                        typename proof_type::path_type path(Depth);
+                        key_type sibling = key;
+                        for (std::size_t level = 0; level < Depth; ++level) {
+                            flip_bit(sibling, level);
+                            path[level][0] = typename proof_type::path_element_type(node(level, sibling),
+                                                                                       bit(sibling, level));
+                            flip_bit(sibling, level);
+                        }
+                        return proof_type(low_bits(key), root(), path);
+                    }
+
+                    // Checks that 'proof' authenticates 'leaf' at 'key'.
+                    template<typename Hashable>
+                    static bool validate(const proof_type &proof, const key_type &key, const Hashable &leaf) {
+                        return matches_key(proof, key) &&
+                               proof_type::path_root(crypto3::hash<hash_type>(leaf), proof.path().begin(),
+                                                     proof.path().end()) == proof.root();
+                    }
+
+                    // Checks that 'proof' authenticates an empty leaf at 'key'.
+                    static bool validate_non_membership(const proof_type &proof, const key_type &key) {
+                        return matches_key(proof, key) &&
+                               proof_type::path_root(empty_leaf(), proof.path().begin(), proof.path().end()) ==
+                                   proof.root();
+                    }
+
+                private:
+                    typedef std::pair<std::size_t, key_type> node_key_type;
+
+                    struct node_key_hash {
+                        std::size_t operator()(const node_key_type &k) const {
+                            std::size_t seed = k.first;
+                            boost::hash_range(seed, k.second.begin(), k.second.end());
+                            return seed;
+                        }
+                    };
+
+                    typedef std::unordered_map<node_key_type, value_type, node_key_hash> nodes_type;
+
+                    static std::size_t bit(const key_type &key, std::size_t level) {
+                        return (key[key.size() - 1 - level / 8] >> (level % 8)) & 1;
+                    }
+
+                    static void flip_bit(key_type &key, std::size_t level) {
+                        key[key.size() - 1 - level / 8] ^= static_cast<std::uint8_t>(1 << (level % 8));
+                    }
+
+                    static void clear_low_bits(key_type &key, std::size_t level) {
+                        std::size_t i = key.size();
+                        for (; level >= 8; level -= 8) {
+                            key[--i] = 0;
+                        }
+                        if (level != 0) {
+                            key[i - 1] &= static_cast<std::uint8_t>(0xff << level);
+                        }
+                    }
+
+                    static std::size_t low_bits(const key_type &key) {
+                        std::size_t idx = 0;
+                        for (std::size_t i = key.size() > sizeof(std::size_t) ? key.size() - sizeof(std::size_t) : 0;
+                             i < key.size(); ++i) {
+                            idx = (idx << 8) | key[i];
+                        }
+                        return idx;
+                    }
+
+                    static bool matches_key(const proof_type &proof, const key_type &key) {
+                        if (proof.path().size() != Depth) {
+                            return false;
+                        }
+                        for (std::size_t level = 0; level < Depth; ++level) {
+                            if (proof.path()[level][0].position() == bit(key, level)) {
+                                return false;
+                            }
+                        }
+                        return true;
+                    }
+
+                    void set_node(std::size_t level, const key_type &prefix, const value_type &x) {
+                        BOOST_ASSERT_MSG(Depth % 8 == 0 || prefix[0] >> (Depth % 8) == 0, "Key out of range");
+                        if (x == _empty_hashes[level]) {
+                            if (_nodes.erase(node_key_type(level, prefix)) != 0 && level == 0) {
+                                --_leaves;
+                            }
+                            return;
+                        }
+                        std::pair<typename nodes_type::iterator, bool> it =
+                            _nodes.emplace(node_key_type(level, prefix), x);
+                        if (!it.second) {
+                            it.first->second = x;
+                        } else if (level == 0) {
+                            ++_leaves;
+                        }
+                    }
+
+                    // Recomputes every node above the leaves 'dirty', one level at a time; all
+                    // parents of a level go through one batch_node_hasher call.
+                    void rehash(std::vector<key_type> &dirty) {
+                        std::sort(dirty.begin(), dirty.end());
+                        std::vector<value_type> children, parents;
+                        for (std::size_t level = 0; level < Depth; ++level) {
+                            for (key_type &key : dirty) {
+                                clear_low_bits(key, level + 1);
+                            }
+                            dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+                            children.clear();
+                            for (key_type key : dirty) {
+                                children.emplace_back(node(level, key));
+                                flip_bit(key, level);
+                                children.emplace_back(node(level, key));
+                            }
+                            parents.resize(dirty.size());
+                            batch_node_hasher<hash_type, 2>::process(children.begin(), dirty.size(), parents.begin());
+                            for (std::size_t i = 0; i < dirty.size(); ++i) {
+                                set_node(level + 1, dirty[i], parents[i]);
+                            }
+                        }
+                    }
+
+                    nodes_type _nodes;
+                    std::array<value_type, Depth + 1> _empty_hashes;
+                    std::size_t _leaves;
+                };
+            }    // namespace detail
+
+            template<typename T, std::size_t Depth>
+            using sparse_merkle_tree =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::sparse_merkle_tree_impl<detail::merkle_tree_node<T>, Depth>,
+                                          detail::sparse_merkle_tree_impl<T, Depth>>::type;
+        }        // namespace containers
+    }            // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_SPARSE_TREE_HPP
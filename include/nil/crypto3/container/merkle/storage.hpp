@@ -0,0 +1,58 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_STORAGE_HPP
+#define CRYPTO3_MERKLE_STORAGE_HPP
+
+#include <memory>
+#include <vector>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            // Storage policies select the container merkle_tree_impl keeps its hashes in.
+            // A policy only has to provide a 'container_type' template with a std::vector-like
+            // interface over contiguous storage.
+
+            // Whole tree in memory, in a std::vector using 'Allocator' rebound to the node type
+            // (e.g. an arena or a std::pmr::polymorphic_allocator). A stateful allocator instance
+            // comes in through the container passed to make_merkle_tree, or through the
+            // allocator-extended constructors of merkle_tree_impl.
+            template<typename Allocator = std::allocator<void>>
+            struct basic_vector_storage {
+                typedef Allocator allocator_type;
+
+                template<typename T>
+                using container_type =
+                    std::vector<T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>;
+            };
+
+            // Whole tree in memory with the default allocator, the default.
+            typedef basic_vector_storage<> vector_storage;
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_STORAGE_HPP
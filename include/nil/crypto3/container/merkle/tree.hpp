@@ -27,8 +27,10 @@
 #ifndef CRYPTO3_MERKLE_TREE_HPP
 #define CRYPTO3_MERKLE_TREE_HPP
 
+#include <algorithm>
 #include <vector>
-#include <cmath>
+#include <iterator>
+#include <stdexcept>
 
 #include <nil/crypto3/algebra/curves/pallas.hpp>
 
@@ -38,6 +40,11 @@
 #include <nil/crypto3/hash/type_traits.hpp>
 #include <nil/crypto3/hash/algorithm/hash.hpp>
 #include <nil/crypto3/container/merkle/node.hpp>
+#include <nil/crypto3/container/merkle/storage.hpp>
+#include <nil/crypto3/container/merkle/layout.hpp>
+#include <nil/crypto3/container/merkle/batch_hasher.hpp>
+#include <nil/crypto3/container/detail/instrumentation.hpp>
+#include <nil/crypto3/container/detail/parallelization.hpp>
 
 namespace nil {
     namespace crypto3 {
@@ -45,65 +52,78 @@ namespace nil {
             namespace detail {
                 // returns next highest power of two from a given number if it is not
                 // already a power of two.
-                inline size_t next_pow2(size_t n) {
-                    return std::pow(2, std::ceil(std::log(n)));
+                constexpr inline size_t next_pow2(size_t n) {
+                    size_t pow2 = 1;
+                    while (pow2 < n) {
+                        pow2 <<= 1;
+                    }
+                    return pow2;
                 }
 
                 // find power of 2 of a number which is power of 2
-                inline size_t log2_pow2(size_t n) {
-                    return next_pow2(n);
+                constexpr inline size_t log2_pow2(size_t n) {
+                    size_t log2 = 0;
+                    while (n > 1) {
+                        n >>= 1;
+                        ++log2;
+                    }
+                    return log2;
+                }
+
+                constexpr inline bool is_pow2(size_t n) {
+                    return n != 0 && (n & (n - 1)) == 0;
+                }
+
+                // Checks if 'n' is a power of 'base', 1 included.
+                constexpr inline bool is_power_of(size_t n, size_t base) {
+                    if (n == 0 || base < 2) {
+                        return n == 1;
+                    }
+                    while (n % base == 0) {
+                        n /= base;
+                    }
+                    return n == 1;
                 }
 
                 // Row_Count calculation given the number of _leaves in the tree and the branches.
-                inline size_t merkle_tree_row_count(size_t leafs, size_t branches) {
+                constexpr inline size_t merkle_tree_row_count(size_t leafs, size_t branches) {
                     // Optimization
-                    if (branches == 2) {
-                        return std::log2(leafs) + 1;
-                    } else {
-                        return round(std::log(leafs) / std::log(branches)) + 1;
+                    if (is_pow2(branches)) {
+                        return log2_pow2(leafs) / log2_pow2(branches) + 1;
                     }
+                    size_t row_count = 1;
+                    for (; leafs > 1; leafs /= branches) {
+                        ++row_count;
+                    }
+                    return row_count;
                 }
 
                 // Tree length calculation given the number of _leaves in the tree and the branches.
-                inline size_t merkle_tree_length(size_t leafs, size_t branches) {
-                    // Optimization
-                    size_t len = leafs;
-                    if (branches == 2) {
-                        len = 2 * leafs - 1;
-                    } else {
-                        size_t cur = leafs;
-                        while (cur != 0) {
-                            cur /= branches;
-                            len += cur;
-                        }
+                // The leaves must be a power of the branches, the rows then sum up to the geometric
+                // series (leafs * branches - 1) / (branches - 1).
+                constexpr inline size_t merkle_tree_length(size_t leafs, size_t branches) {
+                    if (leafs == 0 || branches < 2) {
+                        return leafs;
                     }
-                    return len;
+                    return (leafs * branches - 1) / (branches - 1);
                 }
 
                 // This method returns the number of '_leaves' given a merkle tree
-                // length of 'len', where _leaves must be a power of 2, respecting the
-                // number of branches.
-                inline size_t merkle_tree_leaves(size_t tree_s, size_t branches) {
-                    // Optimization
-                    size_t len = tree_s;
-                    if (branches == 2) {
-                        len = (tree_s + 1) >> 1;
-                    } else {
-                        size_t cur = 1;
-                        while (cur < len) {
-                            len -= cur;
-                            cur *= branches;
-                        }
+                // length of 'len', where _leaves must be a power of the branches. Inverse of
+                // merkle_tree_length.
+                constexpr inline size_t merkle_tree_leaves(size_t tree_s, size_t branches) {
+                    if (branches < 2) {
+                        return tree_s;
                     }
-                    return len;
+                    return (tree_s * (branches - 1) + 1) / branches;
                 }
 
                 // Tree length calculation given the number of _leaves in the tree, the
                 // rows_to_discard, and the branches.
                 inline size_t merkle_tree_cache_size(size_t leafs, size_t branches, size_t rows_to_discard) {
-                    size_t shift = log2_pow2(branches);
                     size_t len = merkle_tree_length(leafs, branches);
                     size_t row_count = merkle_tree_row_count(leafs, branches);
+                    BOOST_ASSERT_MSG(rows_to_discard < row_count - 1, "Too many rows to discard");
 
                     // '_rc - 1' means that we start discarding rows above the base
                     // layer, which is included in the current _rc.
@@ -114,15 +134,15 @@ namespace nil {
 
                     while (row_count > cache_base) {
                         cache_size -= cur_leafs;
-                        cur_leafs >>= shift;    // cur /= branches
+                        cur_leafs /= branches;
                         row_count -= 1;
                     }
 
                     return cache_size;
                 }
 
-                inline bool is_merkle_tree_size_valid(size_t leafs, size_t branches) {
-                    if (branches == 0 || leafs != next_pow2(leafs) || branches != next_pow2(branches)) {
+                constexpr inline bool is_merkle_tree_size_valid(size_t leafs, size_t branches) {
+                    if (branches < 2 || leafs != next_pow2(leafs) || branches != next_pow2(branches)) {
                         return false;
                     }
 
@@ -140,10 +160,103 @@ namespace nil {
 
                 // Given a tree of '_rc' with the specified number of 'branches',
                 // calculate the length of _hashes required for the proof.
-                inline size_t merkle_proof_lemma_length(size_t row_count, size_t branches) {
+                constexpr inline size_t merkle_proof_lemma_length(size_t row_count, size_t branches) {
                     return 2 + ((branches - 1) * (row_count - 1));
                 }
 
+                // Moves between a node position in its row, its parent and its siblings. Shifts
+                // and masks for power-of-two arities, divisions otherwise.
+                template<std::size_t Arity, bool = is_pow2(Arity)>
+                struct merkle_tree_arity {
+                    constexpr static std::size_t parent(std::size_t pos) {
+                        return pos / Arity;
+                    }
+
+                    // Position among the siblings.
+                    constexpr static std::size_t child_index(std::size_t pos) {
+                        return pos % Arity;
+                    }
+
+                    constexpr static std::size_t first_child(std::size_t pos) {
+                        return pos * Arity;
+                    }
+                };
+
+                template<std::size_t Arity>
+                struct merkle_tree_arity<Arity, true> {
+                    constexpr static const std::size_t shift = log2_pow2(Arity);
+                    constexpr static const std::size_t mask = Arity - 1;
+
+                    constexpr static std::size_t parent(std::size_t pos) {
+                        return pos >> shift;
+                    }
+
+                    constexpr static std::size_t child_index(std::size_t pos) {
+                        return pos & mask;
+                    }
+
+                    constexpr static std::size_t first_child(std::size_t pos) {
+                        return pos << shift;
+                    }
+                };
+
+                // Climbs from a leaf to the root, one row per increment. Gives, in the current row,
+                // the position of the path node, its index among its Arity siblings and the position
+                // of the other Arity - 1 siblings in ascending order, without branching on the path
+                // node. Proof generation, validation and leaf updates all walk paths with it.
+                template<std::size_t Arity>
+                class merkle_path_iterator {
+                    typedef merkle_tree_arity<Arity> arity_type;
+
+                public:
+                    explicit merkle_path_iterator(std::size_t leaf_idx, std::size_t row = 0) :
+                        _row(row), _pos(leaf_idx) {
+                    }
+
+                    std::size_t row() const {
+                        return _row;
+                    }
+
+                    // Position of the path node in the current row.
+                    std::size_t position() const {
+                        return _pos;
+                    }
+
+                    std::size_t child_index() const {
+                        return arity_type::child_index(_pos);
+                    }
+
+                    // Position of the first node of the group of the path node.
+                    std::size_t group_begin() const {
+                        return _pos - arity_type::child_index(_pos);
+                    }
+
+                    // Index in the group of the i-th sibling, 0 <= i < Arity - 1, next to a path node
+                    // of index 'child'.
+                    constexpr static std::size_t sibling_index(std::size_t i, std::size_t child) {
+                        return i + (i >= child);
+                    }
+
+                    std::size_t sibling_index(std::size_t i) const {
+                        return sibling_index(i, child_index());
+                    }
+
+                    // Position in the current row of the i-th sibling.
+                    std::size_t sibling(std::size_t i) const {
+                        return group_begin() + sibling_index(i);
+                    }
+
+                    merkle_path_iterator &operator++() {
+                        ++_row;
+                        _pos = arity_type::parent(_pos);
+                        return *this;
+                    }
+
+                private:
+                    std::size_t _row;
+                    std::size_t _pos;
+                };
+
                 // Merkle Tree.
                 //
                 // All _leaves and nodes are stored in a BGL graph structure.
@@ -167,16 +280,24 @@ namespace nil {
                 // ```
                 //
                 // Merkle root is always the top element.
-                template<typename NodeType, size_t Arity = 2>
+                //
+                // Nodes are stored in a container selected by StoragePolicy (see storage.hpp and
+                // mapped_storage.hpp), at the positions given by Layout (see layout.hpp); by default
+                // rows are stored bottom-up, back to back.
+                template<typename NodeType, size_t Arity = 2, typename StoragePolicy = vector_storage,
+                         typename Layout = level_order_layout>
                 struct merkle_tree_impl {
                     typedef NodeType node_type;
+                    typedef StoragePolicy storage_policy_type;
+                    typedef Layout layout_type;
+                    typedef typename layout_type::template mapping_type<Arity> mapping_type;
 
                     typedef typename node_type::hash_type hash_type;
 
                     typedef typename node_type::value_type value_type;
                     constexpr static const std::size_t value_bits = node_type::value_bits;
 
-                    typedef std::vector<value_type> container_type;
+                    typedef typename storage_policy_type::template container_type<value_type> container_type;
 
                     typedef typename container_type::allocator_type allocator_type;
                     typedef typename container_type::reference reference;
@@ -196,64 +317,101 @@ namespace nil {
 
                     merkle_tree_impl(size_t n) :
                             _size(detail::merkle_tree_length(n, Arity)), _leaves(n),
-                            _rc(detail::merkle_tree_row_count(n, Arity)) {
-                        BOOST_ASSERT_MSG(pow(Arity, round(std::log(n) / std::log(Arity))) == n,
+                            _rc(detail::merkle_tree_row_count(n, Arity)), _mapping(n) {
+                        BOOST_ASSERT_MSG(detail::is_power_of(n, Arity),
+                                         "Wrong leaves number, it must be a power of Arity.");
+                    }
+
+                    merkle_tree_impl(size_t n, const allocator_type &a) :
+                            _hashes(a), _size(detail::merkle_tree_length(n, Arity)), _leaves(n),
+                            _rc(detail::merkle_tree_row_count(n, Arity)), _mapping(n) {
+                        BOOST_ASSERT_MSG(detail::is_power_of(n, Arity),
                                          "Wrong leaves number, it must be a power of Arity.");
                     }
 
                     merkle_tree_impl(const merkle_tree_impl &x) :
-                            _hashes(x._hashes), _size(x._size), _leaves(x._leaves), _rc(x._rc) {
+                            _hashes(x._hashes), _size(x._size), _leaves(x._leaves), _rc(x._rc), _mapping(x._mapping) {
                     }
 
-                    merkle_tree_impl(const merkle_tree_impl &x, const allocator_type &a) : _hashes(x.hashes(), a),
+                    merkle_tree_impl(const merkle_tree_impl &x, const allocator_type &a) : _hashes(x._hashes, a),
                                                                                            _size(x._size),
                                                                                            _leaves(x._leaves),
-                                                                                           _rc(x._rc) {}
+                                                                                           _rc(x._rc),
+                                                                                           _mapping(x._mapping) {}
 
+                    // The constructors from a flat sequence of hashes expect all the nodes of a complete
+                    // tree, stored by Layout as make_merkle_tree writes them, and infer the geometry
+                    // from the length alone. Any other length throws std::invalid_argument.
                     merkle_tree_impl(const std::initializer_list<value_type> &il) : _hashes(il) {
-                        set_leaves(detail::merkle_tree_leaves(std::distance(il.begin(), il.end()), Arity));
-                        set_row_count(detail::merkle_tree_row_count(_leaves, Arity));
-                        set_complete_size(detail::merkle_tree_length(_leaves, Arity));
+                        infer_geometry();
                     }
 
                     template<typename Iterator, typename std::enable_if<std::is_same<typename Iterator::value_type, value_type>::value, bool>::type = true>
                     merkle_tree_impl(Iterator first, Iterator last) : _hashes(first, last) {
-                        set_leaves(detail::merkle_tree_leaves(std::distance(first, last), Arity));
-                        set_row_count(detail::merkle_tree_row_count(_leaves, Arity));
-                        set_complete_size(detail::merkle_tree_length(_leaves, Arity));
+                        infer_geometry();
                     }
 
                     merkle_tree_impl(const std::initializer_list<value_type> &il, const allocator_type &a) : _hashes(il, a) {
-                        set_leaves(detail::merkle_tree_leaves(std::distance(il.begin(), il.end()), Arity));
-                        set_row_count(detail::merkle_tree_row_count(_leaves, Arity));
-                        set_complete_size(detail::merkle_tree_length(_leaves, Arity));
+                        infer_geometry();
+                    }
+
+                    // Takes over a container holding the hashes of a complete tree without copying it,
+                    // e.g. a std::vector read back from disk or a mapped_vector reopened over a file
+                    // written by make_merkle_tree.
+                    explicit merkle_tree_impl(container_type &&hashes) : _hashes(std::move(hashes)) {
+                        infer_geometry();
                     }
 
+                    // Same, for a caller which persisted the number of leaves along with the hashes.
+                    // Throws std::invalid_argument unless they form a complete tree of that many leaves.
+                    merkle_tree_impl(container_type &&hashes, size_t leaves) : _hashes(std::move(hashes)) {
+                        if (!detail::is_power_of(leaves, Arity)) {
+                            throw std::invalid_argument("merkle tree: leaves number is not a power of Arity");
+                        }
+                        if (_hashes.size() != detail::merkle_tree_length(leaves, Arity)) {
+                            throw std::invalid_argument("merkle tree: hashes do not form a complete tree");
+                        }
+                        set_geometry(leaves);
+                    }
+
+                    // Moves transfer the hash buffer itself and leave 'x' an empty tree.
                     merkle_tree_impl(merkle_tree_impl &&x)
-                    BOOST_NOEXCEPT(std::is_nothrow_move_constructible<allocator_type>::value):
-                            _hashes(x._hashes),
-                            _size(x._size), _leaves(x._leaves), _rc(x._rc) {
+                    BOOST_NOEXCEPT(std::is_nothrow_move_constructible<container_type>::value):
+                            _hashes(std::move(x._hashes)),
+                            _size(x._size), _leaves(x._leaves), _rc(x._rc), _mapping(x._mapping) {
+                        x.reset_geometry();
                     }
 
                     merkle_tree_impl(merkle_tree_impl &&x, const allocator_type &a) :
-                            _hashes(x.hashes(), a), _size(x._size), _leaves(x._leaves), _rc(x._rc) {
+                            _hashes(std::move(x._hashes), a), _size(x._size), _leaves(x._leaves), _rc(x._rc),
+                            _mapping(x._mapping) {
+                        x.reset_geometry();
                     }
 
                     merkle_tree_impl &operator=(const merkle_tree_impl &x) {
-                        _hashes = x.hashes();
-                        return *this;
-                    }
-
-                    merkle_tree_impl &operator=(merkle_tree_impl &&x) {
                         _hashes = x._hashes;
                         _size = x._size;
                         _leaves = x._leaves;
                         _rc = x._rc;
+                        _mapping = x._mapping;
+                        return *this;
+                    }
+
+                    merkle_tree_impl &operator=(merkle_tree_impl &&x)
+                    BOOST_NOEXCEPT(std::is_nothrow_move_assignable<container_type>::value) {
+                        if (this != &x) {
+                            _hashes = std::move(x._hashes);
+                            _size = x._size;
+                            _leaves = x._leaves;
+                            _rc = x._rc;
+                            _mapping = x._mapping;
+                            x.reset_geometry();
+                        }
                         return *this;
                     }
 
                     bool operator==(const merkle_tree_impl &rhs) const {
-                        return _hashes == rhs.val;
+                        return _leaves == rhs._leaves && _hashes == rhs._hashes;
                     }
 
                     bool operator!=(const merkle_tree_impl &rhs) const {
@@ -261,7 +419,7 @@ namespace nil {
                     }
 
                     allocator_type get_allocator() const BOOST_NOEXCEPT {
-                        return this->val.__alloc();
+                        return _hashes.get_allocator();
                     }
 
                     iterator begin() BOOST_NOEXCEPT {
@@ -372,33 +530,30 @@ namespace nil {
                         return _hashes.back();
                     }
 
-                    value_type *hashes() BOOST_NOEXCEPT {
-                        return _hashes;
+                    pointer hashes() BOOST_NOEXCEPT {
+                        return _hashes.data();
                     }
 
-                    const value_type *hashes() const BOOST_NOEXCEPT {
-                        return _hashes;
+                    const_pointer hashes() const BOOST_NOEXCEPT {
+                        return _hashes.data();
                     }
 
                     void push_back(const_reference _x) {
-                        //    #error ERROR
                         _hashes.push_back(_x);
                     }
 
                     void push_back(value_type &&_x) {
-                        //    #error ERROR
-                        _hashes.push_back(_x);
+                        _hashes.push_back(std::move(_x));
                     }
 
-                    //
                     template<class... Args>
                     reference emplace_back(Args &&..._args) {
-                        return _hashes.template emplace_back(_args...);
+                        return _hashes.emplace_back(std::forward<Args>(_args)...);
                     }
 
                     template<class... Args>
                     iterator emplace(const_iterator _position, Args &&... _args) {
-                        return _hashes.template emplace(_position, _args...);
+                        return _hashes.emplace(_position, std::forward<Args>(_args)...);
                     }
 
                     void pop_back() {
@@ -417,21 +572,35 @@ namespace nil {
                         return _hashes.resize(_sz, _x);
                     }
 
-                    void swap(merkle_tree_impl &other) {
-                        _hashes.swap(other.hashes());
-                        std::swap(_leaves, other.leaves());
-                        std::swap(_rc, other.rc());
-                        std::swap(_size, other.size());
+                    void swap(merkle_tree_impl &other) BOOST_NOEXCEPT {
+                        _hashes.swap(other._hashes);
+                        std::swap(_leaves, other._leaves);
+                        std::swap(_rc, other._rc);
+                        std::swap(_size, other._size);
+                        std::swap(_mapping, other._mapping);
                     }
 
                     value_type root() const BOOST_NOEXCEPT {
                         BOOST_ASSERT_MSG(_size == _hashes.size(), "MerkleTree not fulfilled");
-                        return _hashes[_size - 1];
+                        return _hashes[node_index(_rc - 1, 0)];
                     }
 
                     value_type root() BOOST_NOEXCEPT {
                         BOOST_ASSERT_MSG(_size == _hashes.size(), "MerkleTree not fulfilled");
-                        return _hashes[_size - 1];
+                        return _hashes[node_index(_rc - 1, 0)];
+                    }
+
+                    // Index in the storage of node 'pos' of row 'row', row 0 being the leaves.
+                    size_type node_index(size_t row, size_t pos) const {
+                        return _mapping.index(row, pos);
+                    }
+
+                    const_reference node(size_t row, size_t pos) const {
+                        return _hashes[node_index(row, pos)];
+                    }
+
+                    const mapping_type &mapping() const {
+                        return _mapping;
                     }
 
                     size_t row_count() const {
@@ -442,8 +611,55 @@ namespace nil {
                         return _leaves;
                     }
 
+                    // Replaces leaf 'idx' with the hash of 'leaf' and rehashes its path to the root.
+                    template<typename Hashable>
+                    void update_leaf(size_type idx, const Hashable &leaf) {
+                        BOOST_ASSERT_MSG(_size == _hashes.size(), "MerkleTree not fulfilled");
+                        BOOST_ASSERT_MSG(idx < _leaves, "Leaf index out of range");
+
+                        _hashes[node_index(0, idx)] = crypto3::hash<hash_type>(leaf);
+                        for (merkle_path_iterator<Arity> it(idx); (++it).row() < _rc;) {
+                            hash_merkle_row<hash_type, Arity>(_hashes.begin(), _mapping, it.row(), it.position(),
+                                                              it.position() + 1);
+                        }
+                    }
+
+                    // Applies a batch of (leaf index, leaf) pairs, later pairs win on repeated indices.
+                    // Every internal node above an updated leaf is rehashed exactly once, runs of
+                    // adjacent dirty nodes go through the batched node hasher.
+                    template<typename InputIterator>
+                    void update_leaves(InputIterator first, InputIterator last) {
+                        BOOST_ASSERT_MSG(_size == _hashes.size(), "MerkleTree not fulfilled");
+
+                        std::vector<size_type> dirty;
+                        for (; first != last; ++first) {
+                            BOOST_ASSERT_MSG(first->first < _leaves, "Leaf index out of range");
+                            _hashes[node_index(0, first->first)] = crypto3::hash<hash_type>(first->second);
+                            dirty.emplace_back(first->first);
+                        }
+                        std::sort(dirty.begin(), dirty.end());
+
+                        for (size_t row = 1; row < _rc; ++row) {
+                            for (auto &idx : dirty) {
+                                idx = merkle_tree_arity<Arity>::parent(idx);
+                            }
+                            dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+                            for (auto run_begin = dirty.begin(); run_begin != dirty.end();) {
+                                auto run_end = run_begin + 1;
+                                while (run_end != dirty.end() && *run_end == *(run_end - 1) + 1) {
+                                    ++run_end;
+                                }
+                                hash_merkle_row<hash_type, Arity>(_hashes.begin(), _mapping, row, *run_begin,
+                                                                  *run_begin + (run_end - run_begin));
+                                run_begin = run_end;
+                            }
+                        }
+                    }
+
                     void set_leaves(size_t s) {
                         _leaves = s;
+                        _mapping = mapping_type(s);
                     }
 
                     void set_row_count(size_t s) {
@@ -455,6 +671,27 @@ namespace nil {
                     }
 
                 protected:
+                    void set_geometry(size_t leaves) {
+                        set_leaves(leaves);
+                        set_row_count(detail::merkle_tree_row_count(leaves, Arity));
+                        set_complete_size(detail::merkle_tree_length(leaves, Arity));
+                    }
+
+                    void infer_geometry() {
+                        set_geometry(detail::merkle_tree_leaves(_hashes.size(), Arity));
+                        // the buffer may come straight from disk, so this holds in release builds too
+                        if (!_hashes.empty() && !(detail::is_power_of(_leaves, Arity) && _size == _hashes.size())) {
+                            throw std::invalid_argument("merkle tree: hashes do not form a complete tree");
+                        }
+                    }
+
+                    void reset_geometry() BOOST_NOEXCEPT {
+                        _size = 0;
+                        _leaves = 0;
+                        _rc = 0;
+                        _mapping = mapping_type();
+                    }
+
                     container_type _hashes;
 
                     size_t _size;
@@ -467,45 +704,96 @@ namespace nil {
                     //
                     // Internally, this code considers only the _rc.
                     size_t _rc;
+                    mapping_type _mapping;
                 };
 
-                template<typename T, typename LeafIterator>
-                typename T::digest_type generate_hash(LeafIterator first, LeafIterator last) {
-                    accumulator_set<T> acc;
-                    while (first != last) {
-                        crypto3::hash<T>(*first++, acc);
-                    }
-                    return accumulators::extract::hash<T>(acc);
+                // Builds the tree straight into 'storage' (e.g. a mapped_vector bound to a file), which
+                // the returned tree then owns.
+                template<typename T, std::size_t Arity, typename StoragePolicy, typename Layout = level_order_layout,
+                         typename LeafIterator>
+                merkle_tree_impl<T, Arity, StoragePolicy, Layout>
+                    make_merkle_tree(LeafIterator first, LeafIterator last,
+                                     typename merkle_tree_impl<T, Arity, StoragePolicy, Layout>::container_type &&storage) {
+                    typedef merkle_tree_impl<T, Arity, StoragePolicy, Layout> tree_type;
+                    typedef typename tree_type::hash_type hash_type;
+
+                    CRYPTO3_CONTAINERS_TIME_SCOPE(tree_build);
+
+                    const std::size_t leaves = std::distance(first, last);
+                    BOOST_ASSERT_MSG(detail::is_power_of(leaves, Arity),
+                                     "Wrong leaves number, it must be a power of Arity.");
+
+                    const typename tree_type::mapping_type mapping(leaves);
+                    storage.clear();
+                    const std::size_t length = detail::merkle_tree_length(leaves, Arity);
+                    CRYPTO3_CONTAINERS_COUNT(allocation, storage.capacity() < length);
+                    storage.resize(length);
+                    for (std::size_t i = 0; first != last; ++i) {
+                        storage[mapping.index(0, i)] = crypto3::hash<hash_type>(*first++);
+                    }
+                    CRYPTO3_CONTAINERS_COUNT(accumulator_construction, leaves);
+                    CRYPTO3_CONTAINERS_COUNT(hash_invocation, leaves);
+
+                    const std::size_t row_count = detail::merkle_tree_row_count(leaves, Arity);
+                    for (std::size_t row = 1, row_len = leaves / Arity; row < row_count; ++row, row_len /= Arity) {
+                        hash_merkle_row<hash_type, Arity>(storage.begin(), mapping, row, 0, row_len);
+                    }
+                    return tree_type(std::move(storage));
                 }
 
                 template<typename T, std::size_t Arity, typename LeafIterator>
                 merkle_tree_impl<T, Arity> make_merkle_tree(LeafIterator first, LeafIterator last) {
+                    return make_merkle_tree<T, Arity, vector_storage>(
+                        first, last, typename merkle_tree_impl<T, Arity>::container_type());
+                }
+
+                // Same tree as make_merkle_tree(first, last), built with up to 'threads' threads.
+                // Leaves are hashed in contiguous blocks, then every row is split into blocks of
+                // Arity-sized groups; rows are processed one after another, so each row only reads
+                // the completely finished row below it and the result is bit-identical to the
+                // serial version.
+                template<typename T, std::size_t Arity, typename LeafIterator>
+                merkle_tree_impl<T, Arity> make_merkle_tree(LeafIterator first, LeafIterator last,
+                                                            std::size_t threads) {
                     typedef T node_type;
                     typedef typename node_type::hash_type hash_type;
 
-                    merkle_tree_impl<T, Arity> ret(std::distance(first, last));
-                    ret.reserve(ret.complete_size());
-
-                    while (first != last) {
-                        ret.emplace_back(crypto3::hash<hash_type>(*first++));
-                    }
+                    CRYPTO3_CONTAINERS_TIME_SCOPE(tree_build);
 
-                    std::size_t row_idx = ret.leaves(), row_size = row_idx / Arity;
-                    typename merkle_tree_impl<T, Arity>::iterator it = ret.begin();
+                    merkle_tree_impl<T, Arity> ret(std::distance(first, last));
+                    CRYPTO3_CONTAINERS_COUNT(allocation, ret.capacity() < ret.complete_size());
+                    ret.resize(ret.complete_size());
 
-                    for (size_t row_number = 1; row_number < ret.row_count(); ++row_number, row_size /= Arity) {
-                        for (size_t i = 0; i < row_size; ++i, it += Arity) {
-                            ret.emplace_back(generate_hash<hash_type>(it, it + Arity));
+                    parallel_for(0, ret.leaves(), threads, [&ret, first](std::size_t begin, std::size_t end) {
+                        LeafIterator leaf = std::next(first, begin);
+                        for (std::size_t i = begin; i < end; ++i) {
+                            ret[i] = crypto3::hash<hash_type>(*leaf++);
                         }
+                    });
+                    CRYPTO3_CONTAINERS_COUNT(accumulator_construction, ret.leaves());
+                    CRYPTO3_CONTAINERS_COUNT(hash_invocation, ret.leaves());
+
+                    std::size_t row_begin_idx = 0, row_len = ret.leaves();
+                    for (size_t row_number = 1; row_number < ret.row_count(); ++row_number) {
+                        const std::size_t parent_row_begin_idx = row_begin_idx + row_len;
+                        parallel_for(0, row_len / Arity, threads,
+                                     [&ret, row_begin_idx, parent_row_begin_idx](std::size_t begin, std::size_t end) {
+                                         batch_node_hasher<hash_type, Arity>::process(
+                                             ret.begin() + row_begin_idx + begin * Arity, end - begin,
+                                             ret.begin() + parent_row_begin_idx + begin);
+                                     });
+                        row_begin_idx = parent_row_begin_idx;
+                        row_len /= Arity;
                     }
                     return ret;
                 }
             }    // namespace detail
 
-            template<typename T, std::size_t Arity>
+            template<typename T, std::size_t Arity, typename StoragePolicy = vector_storage,
+                     typename Layout = level_order_layout>
             using merkle_tree = typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
-                    detail::merkle_tree_impl<detail::merkle_tree_node<T>, Arity>,
-                    detail::merkle_tree_impl<T, Arity>>::type;
+                    detail::merkle_tree_impl<detail::merkle_tree_node<T>, Arity, StoragePolicy, Layout>,
+                    detail::merkle_tree_impl<T, Arity, StoragePolicy, Layout>>::type;
 
             template<typename T, std::size_t Arity, typename LeafIterator>
             merkle_tree<T, Arity> make_merkle_tree(LeafIterator first, LeafIterator last) {
@@ -515,6 +803,25 @@ namespace nil {
                         Arity>(first, last);
             }
 
+            template<typename T, std::size_t Arity, typename LeafIterator>
+            merkle_tree<T, Arity> make_merkle_tree(LeafIterator first, LeafIterator last, std::size_t threads) {
+                return detail::make_merkle_tree<typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                        detail::merkle_tree_node<T>,
+                        T>::type,
+                        Arity>(first, last, threads);
+            }
+
+            template<typename T, std::size_t Arity, typename StoragePolicy, typename Layout = level_order_layout,
+                     typename LeafIterator>
+            merkle_tree<T, Arity, StoragePolicy, Layout>
+                make_merkle_tree(LeafIterator first, LeafIterator last,
+                                 typename merkle_tree<T, Arity, StoragePolicy, Layout>::container_type &&storage) {
+                return detail::make_merkle_tree<typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                        detail::merkle_tree_node<T>,
+                        T>::type,
+                        Arity, StoragePolicy, Layout>(first, last, std::move(storage));
+            }
+
         }    // namespace containers
     }        // namespace crypto3
 }    // namespace nil
@@ -0,0 +1,213 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#ifndef CRYPTO3_MERKLE_TREE_BATCH_HPP
+#define CRYPTO3_MERKLE_TREE_BATCH_HPP
+
+#include <array>
+#include <iterator>
+#include <vector>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+
+namespace nil {
+    namespace crypto3 {
+        namespace containers {
+            namespace detail {
+                template<typename NodeType, std::size_t Arity>
+                class merkle_tree_batch_impl;
+
+                // One tree of a merkle_tree_batch_impl, valid as long as the batch is.
+                template<typename NodeType, std::size_t Arity>
+                class merkle_tree_batch_view {
+                public:
+                    typedef merkle_tree_batch_impl<NodeType, Arity> batch_type;
+                    typedef NodeType node_type;
+                    typedef typename node_type::hash_type hash_type;
+                    typedef typename node_type::value_type value_type;
+
+                    constexpr static const std::size_t arity = Arity;
+
+                    merkle_tree_batch_view(const batch_type &batch, std::size_t tree) : _batch(&batch), _tree(tree) {
+                    }
+
+                    const value_type &node(std::size_t row, std::size_t pos) const {
+                        return _batch->node(_tree, row, pos);
+                    }
+
+                    const value_type &root() const {
+                        return _batch->root(_tree);
+                    }
+
+                    std::size_t leaves() const {
+                        return _batch->leaves();
+                    }
+
+                    std::size_t row_count() const {
+                        return _batch->row_count();
+                    }
+
+                    std::size_t size() const {
+                        return _batch->tree_size();
+                    }
+
+                    std::size_t tree_index() const {
+                        return _tree;
+                    }
+
+                private:
+                    const batch_type *_batch;
+                    std::size_t _tree;
+                };
+
+                // Several trees of the same shape, built together into one pooled buffer.
+                //
+                // Rows are stored bottom-up and every row holds that row of all the trees one
+                // after another, so hashing a row of the whole batch is a single batch_node_hasher
+                // call over trees() * row length / Arity groups. Small trees (e.g. one per column
+                // in FRI commitments) then fill the hashing lanes and threads as well as one big
+                // tree does.
+                template<typename NodeType, std::size_t Arity>
+                class merkle_tree_batch_impl {
+                public:
+                    typedef NodeType node_type;
+                    typedef typename node_type::hash_type hash_type;
+
+                    typedef typename node_type::value_type value_type;
+                    constexpr static const std::size_t value_bits = node_type::value_bits;
+
+                    constexpr static const std::size_t arity = Arity;
+
+                    typedef merkle_tree_batch_view<NodeType, Arity> view_type;
+
+                    merkle_tree_batch_impl() : _trees(0), _leaves(0), _rc(0), _row_offsets(), _row_lengths() {
+                    }
+
+                    // Leaves [first, last) are the leaves of the first tree, then those of the second
+                    // one and so on; there must be trees * a power of Arity of them.
+                    template<typename LeafIterator>
+                    merkle_tree_batch_impl(LeafIterator first, LeafIterator last, std::size_t trees,
+                                           std::size_t threads = 1) :
+                        _trees(trees),
+                        _leaves(trees == 0 ? 0 : std::distance(first, last) / trees),
+                        _rc(detail::merkle_tree_row_count(_leaves, Arity)), _row_offsets(), _row_lengths() {
+                        BOOST_ASSERT_MSG(static_cast<std::size_t>(std::distance(first, last)) == _trees * _leaves,
+                                         "Every tree must have the same number of leaves");
+                        BOOST_ASSERT_MSG(_trees == 0 || detail::is_power_of(_leaves, Arity),
+                                         "Wrong leaves number, it must be a power of Arity.");
+
+                        CRYPTO3_CONTAINERS_TIME_SCOPE(tree_build);
+
+                        for (std::size_t row = 0, row_len = _leaves; row < _rc; ++row, row_len /= Arity) {
+                            _row_lengths[row] = row_len;
+                            _row_offsets[row] = row == 0 ? 0 : _row_offsets[row - 1] + _trees * _row_lengths[row - 1];
+                        }
+                        CRYPTO3_CONTAINERS_COUNT(allocation, 1);
+                        _pool.resize(_trees * detail::merkle_tree_length(_leaves, Arity));
+
+                        parallel_for(0, _trees * _leaves, threads, [this, first](std::size_t begin, std::size_t end) {
+                            LeafIterator leaf = std::next(first, begin);
+                            for (std::size_t i = begin; i < end; ++i) {
+                                _pool[i] = crypto3::hash<hash_type>(*leaf++);
+                            }
+                        });
+                        CRYPTO3_CONTAINERS_COUNT(accumulator_construction, _trees * _leaves);
+                        CRYPTO3_CONTAINERS_COUNT(hash_invocation, _trees * _leaves);
+
+                        for (std::size_t row = 1; row < _rc; ++row) {
+                            const std::size_t children = _row_offsets[row - 1], parents = _row_offsets[row];
+                            parallel_for(0, _trees * _row_lengths[row], threads,
+                                         [this, children, parents](std::size_t begin, std::size_t end) {
+                                             batch_node_hasher<hash_type, Arity>::process(
+                                                 _pool.begin() + children + begin * Arity, end - begin,
+                                                 _pool.begin() + parents + begin);
+                                         });
+                        }
+                    }
+
+                    // Number of trees.
+                    std::size_t trees() const {
+                        return _trees;
+                    }
+
+                    std::size_t leaves() const {
+                        return _leaves;
+                    }
+
+                    std::size_t row_count() const {
+                        return _rc;
+                    }
+
+                    // Number of nodes of every tree.
+                    std::size_t tree_size() const {
+                        return _trees == 0 ? 0 : _pool.size() / _trees;
+                    }
+
+                    const value_type &node(std::size_t tree, std::size_t row, std::size_t pos) const {
+                        BOOST_ASSERT_MSG(tree < _trees && row < _rc && pos < _row_lengths[row], "Node out of range");
+                        return _pool[_row_offsets[row] + tree * _row_lengths[row] + pos];
+                    }
+
+                    const value_type &root(std::size_t tree) const {
+                        return node(tree, _rc - 1, 0);
+                    }
+
+                    view_type operator[](std::size_t tree) const {
+                        return view_type(*this, tree);
+                    }
+
+                    // The pooled nodes of all the trees, in the order described above.
+                    const std::vector<value_type> &pool() const {
+                        return _pool;
+                    }
+
+                private:
+                    std::vector<value_type> _pool;
+                    std::size_t _trees;
+                    std::size_t _leaves;
+                    std::size_t _rc;
+                    std::array<std::size_t, merkle_tree_max_rows> _row_offsets;
+                    std::array<std::size_t, merkle_tree_max_rows> _row_lengths;
+                };
+            }    // namespace detail
+
+            template<typename T, std::size_t Arity>
+            using merkle_tree_batch =
+                typename std::conditional<nil::crypto3::detail::is_hash<T>::value,
+                                          detail::merkle_tree_batch_impl<detail::merkle_tree_node<T>, Arity>,
+                                          detail::merkle_tree_batch_impl<T, Arity>>::type;
+
+            // Builds 'trees' trees of std::distance(first, last) / trees leaves each, see
+            // merkle_tree_batch_impl.
+            template<typename T, std::size_t Arity, typename LeafIterator>
+            merkle_tree_batch<T, Arity> make_merkle_tree_batch(LeafIterator first, LeafIterator last,
+                                                               std::size_t trees, std::size_t threads = 1) {
+                return merkle_tree_batch<T, Arity>(first, last, trees, threads);
+            }
+        }    // namespace containers
+    }        // namespace crypto3
+}    // namespace nil
+
+#endif    // CRYPTO3_MERKLE_TREE_BATCH_HPP
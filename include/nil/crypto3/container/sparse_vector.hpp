@@ -28,27 +28,130 @@
 #ifndef CRYPTO3_ZK_SPARSE_VECTOR_HPP
 #define CRYPTO3_ZK_SPARSE_VECTOR_HPP
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <vector>
 #include <numeric>
+#include <utility>
 
 #include <nil/crypto3/algebra/multiexp/multiexp.hpp>
 #include <nil/crypto3/algebra/multiexp/policies.hpp>
 
+#include <nil/crypto3/container/detail/instrumentation.hpp>
+#include <nil/crypto3/container/detail/parallelization.hpp>
+
 namespace nil {
     namespace crypto3 {
         namespace container {
 
+            /**
+             * Multiexp method of sparse_vector::insert using 'Small' for runs shorter than 'Threshold'
+             * terms and 'Large' for the others, e.g. the naive method for a handful of terms and the
+             * bucket method (BDLO12) for long runs.
+             */
+            template<typename Small, typename Large, std::size_t Threshold>
+            struct multiexp_method_by_size { };
+
+            namespace detail {
+                template<typename Method>
+                struct sparse_vector_multiexp {
+                    template<typename BaseIterator, typename ScalarIterator>
+                    static typename std::iterator_traits<BaseIterator>::value_type
+                        process(BaseIterator vec_start, BaseIterator vec_end, ScalarIterator scalar_start,
+                                ScalarIterator scalar_end, std::size_t chunks) {
+                        return algebra::multiexp<Method>(vec_start, vec_end, scalar_start, scalar_end, chunks);
+                    }
+                };
+
+                template<typename Small, typename Large, std::size_t Threshold>
+                struct sparse_vector_multiexp<multiexp_method_by_size<Small, Large, Threshold>> {
+                    template<typename BaseIterator, typename ScalarIterator>
+                    static typename std::iterator_traits<BaseIterator>::value_type
+                        process(BaseIterator vec_start, BaseIterator vec_end, ScalarIterator scalar_start,
+                                ScalarIterator scalar_end, std::size_t chunks) {
+                        if (static_cast<std::size_t>(std::distance(vec_start, vec_end)) < Threshold) {
+                            return sparse_vector_multiexp<Small>::process(vec_start, vec_end, scalar_start,
+                                                                          scalar_end, chunks);
+                        }
+                        return sparse_vector_multiexp<Large>::process(vec_start, vec_end, scalar_start, scalar_end,
+                                                                      chunks);
+                    }
+                };
+
+                // Values [value_first, value_last) of a sparse vector, to be multiplied by the consecutive
+                // scalars from 'scalar_first' on.
+                struct multiexp_piece {
+                    std::size_t value_first;
+                    std::size_t value_last;
+                    std::size_t scalar_first;
+                };
+
+                // Appends a run of values to 'pieces', cut into pieces of at most 'grain' terms.
+                inline void append_multiexp_pieces(std::vector<multiexp_piece> &pieces, std::size_t value_first,
+                                                   std::size_t value_last, std::size_t scalar_first,
+                                                   std::size_t grain) {
+                    while (value_first != value_last) {
+                        const std::size_t len = std::min(grain, value_last - value_first);
+                        pieces.push_back({value_first, value_first + len, scalar_first});
+                        value_first += len;
+                        scalar_first += len;
+                    }
+                }
+
+                // Number of terms per piece spreading 'terms' over 'threads' threads.
+                inline std::size_t multiexp_piece_grain(std::size_t terms, std::size_t threads) {
+                    threads = std::max<std::size_t>(threads, 1);
+                    return std::max<std::size_t>(1, (terms + threads - 1) / threads);
+                }
+
+                // Sum of the multiexps of all the 'pieces', computed on up to 'threads' threads.
+                template<typename Method, typename ValueIterator, typename ScalarIterator>
+                typename std::iterator_traits<ValueIterator>::value_type
+                    accumulate_multiexp_pieces(const std::vector<multiexp_piece> &pieces, ValueIterator values,
+                                               ScalarIterator scalars, std::size_t threads) {
+                    typedef typename std::iterator_traits<ValueIterator>::value_type value_type;
+#ifdef MULTICORE
+                    // with a single thread, let the multiexp itself use OpenMP; to override, set the
+                    // OMP_NUM_THREADS env var or call omp_set_num_threads()
+                    const std::size_t chunks = threads > 1 ? 1 : omp_get_max_threads();
+#else
+                    const std::size_t chunks = 1;
+#endif
+
+                    std::vector<value_type> partial(pieces.size());
+                    containers::detail::parallel_for(
+                        0, pieces.size(), threads, [&](std::size_t begin, std::size_t end) {
+                            for (std::size_t i = begin; i < end; ++i) {
+                                const multiexp_piece &piece = pieces[i];
+                                partial[i] = sparse_vector_multiexp<Method>::process(
+                                    values + piece.value_first, values + piece.value_last,
+                                    scalars + piece.scalar_first,
+                                    scalars + (piece.scalar_first + piece.value_last - piece.value_first), chunks);
+                            }
+                        });
+
+                    value_type accumulated_value = value_type::zero();
+                    for (const value_type &p : partial) {
+                        accumulated_value = accumulated_value + p;
+                    }
+                    return accumulated_value;
+                }
+            }    // namespace detail
+
             /**
              * A sparse vector is a list of indices along with corresponding values.
              * The indices are selected from the set {0,1,...,domain_size-1}.
+             * Both indices and values are allocated through (rebound copies of) Allocator.
              */
-            template<typename Type>
+            template<typename Type, typename Allocator = std::allocator<typename Type::value_type>>
             class sparse_vector {
                 using underlying_value_type = typename Type::value_type;
 
                 template<typename T>
-                using container_type = std::vector<T>;
+                using container_type =
+                    std::vector<T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>;
 
                 typedef container_type<underlying_value_type> value_container_type;
 
@@ -68,36 +171,46 @@ namespace nil {
                 typedef typename value_container_type::reverse_iterator reverse_iterator;
                 typedef typename value_container_type::const_reverse_iterator const_reverse_iterator;
 
+                typedef typename container_type<std::size_t>::allocator_type index_allocator_type;
+
                 container_type<std::size_t> indices;
                 container_type<underlying_value_type> values;
                 std::size_t domain_size_;
 
                 sparse_vector() = default;
 
-                sparse_vector(const sparse_vector<Type> &other) = default;
+                sparse_vector(const sparse_vector<Type, Allocator> &other) = default;
 
-                sparse_vector(sparse_vector<Type> &&other) = default;
+                sparse_vector(sparse_vector<Type, Allocator> &&other) = default;
 
-                sparse_vector(value_container_type &&v) : values(std::move(v)), domain_size_(values.size()) {
+                sparse_vector(value_container_type &&v) :
+                    indices(index_allocator_type(v.get_allocator())), values(std::move(v)),
+                    domain_size_(values.size()) {
                     indices.resize(domain_size_);
                     std::iota(indices.begin(), indices.end(), 0);
                 }
 
+                explicit sparse_vector(const allocator_type &a) :
+                    indices(index_allocator_type(a)), values(a), domain_size_(0) {
+                }
+
                 explicit sparse_vector(size_type n) : values(n) {
                 }
-                explicit sparse_vector(size_type n, const allocator_type &a) : values(n, a) {
+                explicit sparse_vector(size_type n, const allocator_type &a) :
+                    indices(index_allocator_type(a)), values(n, a) {
                 }
 
                 sparse_vector(size_type n, const value_type &x) : values(n, x) {
                 }
-                sparse_vector(size_type n, const value_type &x, const allocator_type &a) : values(n, x, a) {
+                sparse_vector(size_type n, const value_type &x, const allocator_type &a) :
+                    indices(index_allocator_type(a)), values(n, x, a) {
                 }
                 template<typename InputIterator>
                 sparse_vector(InputIterator first, InputIterator last) : values(first, last) {
                 }
                 template<typename InputIterator>
                 sparse_vector(InputIterator first, InputIterator last, const allocator_type &a) :
-                    values(first, last, a) {
+                    indices(index_allocator_type(a)), values(first, last, a) {
                 }
 
                 ~sparse_vector() = default;
@@ -105,18 +218,19 @@ namespace nil {
                 sparse_vector(std::initializer_list<value_type> il) : values(il) {
                 }
 
-                sparse_vector(std::initializer_list<value_type> il, const allocator_type &a) : values(il, a) {
+                sparse_vector(std::initializer_list<value_type> il, const allocator_type &a) :
+                    indices(index_allocator_type(a)), values(il, a) {
                 }
 
-                sparse_vector<Type> &operator=(const sparse_vector<Type> &other) = default;
-                sparse_vector<Type> &operator=(sparse_vector<Type> &&other) = default;
+                sparse_vector<Type, Allocator> &operator=(const sparse_vector<Type, Allocator> &other) = default;
+                sparse_vector<Type, Allocator> &operator=(sparse_vector<Type, Allocator> &&other) = default;
 
                 underlying_value_type operator[](const std::size_t idx) const {
                     auto it = std::lower_bound(indices.begin(), indices.end(), idx);
                     return (it != indices.end() && *it == idx) ? values[it - indices.begin()] : underlying_value_type();
                 }
 
-                bool operator==(const sparse_vector<Type> &other) const {
+                bool operator==(const sparse_vector<Type, Allocator> &other) const {
                     if (this->domain_size_ != other.domain_size_) {
                         return false;
                     }
@@ -200,6 +314,10 @@ namespace nil {
                     return true;
                 }
 
+                allocator_type get_allocator() const {
+                    return values.get_allocator();
+                }
+
                 bool empty() const {
                     return indices.empty();
                 }
@@ -217,78 +335,87 @@ namespace nil {
                 }
 
                 /* return a pair consisting of the accumulated value and the sparse vector of non-accumulated values
+                 *
+                 * The entries with indices in [offset, offset + distance(first, last)) are multiplied by their
+                 * scalars in [first, last) and summed up, one MultiexpMethod multiexp per run of consecutive
+                 * indices. With threads > 1 the runs are cut into pieces multiexp'ed on that many threads.
                  */
-                template<typename InputBaseIterator>
-                std::pair<underlying_value_type, sparse_vector<Type>>
-                    insert(std::size_t offset, InputBaseIterator first, InputBaseIterator last) const {
-#ifdef MULTICORE
-                    const std::size_t chunks = omp_get_max_threads();    // to override, set OMP_NUM_THREADS env var
-                                                                         // or call omp_set_num_threads()
-#else
-                    const std::size_t chunks = 1;
-#endif
+                template<typename MultiexpMethod = algebra::policies::multiexp_method_bos_coster,
+                         typename InputBaseIterator>
+                std::pair<underlying_value_type, sparse_vector<Type, Allocator>>
+                    insert(std::size_t offset, InputBaseIterator first, InputBaseIterator last,
+                           std::size_t threads = 1) const {
+                    CRYPTO3_CONTAINERS_TIME_SCOPE(sparse_vector_insert);
+
+                    const std::pair<std::size_t, std::size_t> block = accumulated_block(offset, first, last);
 
-                    underlying_value_type accumulated_value = underlying_value_type::zero();
-                    sparse_vector<Type> resulting_vector;
+                    sparse_vector<Type, Allocator> resulting_vector(values.get_allocator());
                     resulting_vector.domain_size_ = domain_size_;
+                    const std::size_t kept = indices.size() - (block.second - block.first);
+                    CRYPTO3_CONTAINERS_COUNT(allocation, kept != 0 ? 2 : 0);
+                    resulting_vector.indices.reserve(kept);
+                    resulting_vector.values.reserve(kept);
+                    resulting_vector.indices.insert(resulting_vector.indices.end(), indices.begin(),
+                                                    indices.begin() + block.first);
+                    resulting_vector.indices.insert(resulting_vector.indices.end(), indices.begin() + block.second,
+                                                    indices.end());
+                    resulting_vector.values.insert(resulting_vector.values.end(), values.begin(),
+                                                   values.begin() + block.first);
+                    resulting_vector.values.insert(resulting_vector.values.end(), values.begin() + block.second,
+                                                   values.end());
+
+                    return std::make_pair(accumulate_block<MultiexpMethod>(block, offset, first, threads),
+                                          std::move(resulting_vector));
+                }
+
+                /* same as insert, but removes the accumulated entries from this vector in place, without
+                 * reallocating it, and only returns the accumulated value
+                 */
+                template<typename MultiexpMethod = algebra::policies::multiexp_method_bos_coster,
+                         typename InputBaseIterator>
+                underlying_value_type insert_inplace(std::size_t offset, InputBaseIterator first,
+                                                     InputBaseIterator last, std::size_t threads = 1) {
+                    CRYPTO3_CONTAINERS_TIME_SCOPE(sparse_vector_insert);
+
+                    const std::pair<std::size_t, std::size_t> block = accumulated_block(offset, first, last);
+                    const underlying_value_type accumulated_value =
+                        accumulate_block<MultiexpMethod>(block, offset, first, threads);
+                    indices.erase(indices.begin() + block.first, indices.begin() + block.second);
+                    values.erase(values.begin() + block.first, values.begin() + block.second);
+                    return accumulated_value;
+                }
 
+            private:
+                // positions [first, second) of the entries accumulated by insert; indices are sorted
+                template<typename InputBaseIterator>
+                std::pair<std::size_t, std::size_t> accumulated_block(std::size_t offset, InputBaseIterator first,
+                                                                      InputBaseIterator last) const {
                     const std::size_t range_len = std::distance(first, last);
-                    bool in_block = false;
-                    std::size_t first_pos = -1,
-                                last_pos = -1;    // g++ -flto emits unitialized warning, even though in_block
-                    // guards for such cases.
-
-                    for (std::size_t i = 0; i < indices.size(); ++i) {
-                        const bool matching_pos = (offset <= indices[i] && indices[i] < offset + range_len);
-                        // printf("i = %zu, pos[i] = %zu, offset = %zu, w_size = %zu\n", i, indices[i], offset,
-                        // w_size);
-                        bool copy_over;
-
-                        if (in_block) {
-                            if (matching_pos && last_pos == i - 1) {
-                                // block can be extended, do it
-                                last_pos = i;
-                                copy_over = false;
-                            } else {
-                                // block has ended here
-                                in_block = false;
-                                copy_over = true;
-
-                                accumulated_value = accumulated_value +
-                                                    algebra::multiexp<algebra::policies::multiexp_method_bos_coster>(
-                                                        values.begin() + first_pos, values.begin() + last_pos + 1,
-                                                        first + (indices[first_pos] - offset),
-                                                        last + (indices[last_pos] - offset) + 1, chunks);
-                            }
-                        } else {
-                            if (matching_pos) {
-                                // block can be started
-                                first_pos = i;
-                                last_pos = i;
-                                in_block = true;
-                                copy_over = false;
-                            } else {
-                                copy_over = true;
-                            }
-                        }
+                    const std::size_t block_first =
+                        std::lower_bound(indices.begin(), indices.end(), offset) - indices.begin();
+                    const std::size_t block_last =
+                        std::lower_bound(indices.begin() + block_first, indices.end(), offset + range_len) -
+                        indices.begin();
+                    return std::make_pair(block_first, block_last);
+                }
 
-                        if (copy_over) {
-                            resulting_vector.indices.emplace_back(indices[i]);
-                            resulting_vector.values.emplace_back(values[i]);
+                template<typename MultiexpMethod, typename InputBaseIterator>
+                underlying_value_type accumulate_block(std::pair<std::size_t, std::size_t> block, std::size_t offset,
+                                                       InputBaseIterator first, std::size_t threads) const {
+                    // runs of consecutive indices, cut to spread the terms over the threads
+                    const std::size_t grain = detail::multiexp_piece_grain(block.second - block.first, threads);
+                    std::vector<detail::multiexp_piece> pieces;
+                    for (std::size_t run_first = block.first; run_first != block.second;) {
+                        std::size_t run_last = run_first + 1;
+                        while (run_last != block.second && indices[run_last] == indices[run_last - 1] + 1) {
+                            ++run_last;
                         }
+                        detail::append_multiexp_pieces(pieces, run_first, run_last, indices[run_first] - offset,
+                                                       grain);
+                        run_first = run_last;
                     }
-
-                    if (in_block) {
-                        accumulated_value =
-                            accumulated_value + algebra::multiexp<algebra::policies::multiexp_method_bos_coster>(
-                                                    values.begin() + first_pos,
-                                                    values.begin() + last_pos + 1,
-                                                    first + (indices[first_pos] - offset),
-                                                    first + (indices[last_pos] - offset) + 1,
-                                                    chunks);
-                    }
-
-                    return std::make_pair(accumulated_value, resulting_vector);
+                    return detail::accumulate_multiexp_pieces<MultiexpMethod>(pieces, values.begin(), first,
+                                                                              threads);
                 }
             };
         }    // namespace container
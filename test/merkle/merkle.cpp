@@ -26,6 +26,11 @@
 
 #define BOOST_TEST_MODULE containter_merkletree_test
 
+// Checked against the hash accumulator in merkletree_poseidon_node_hash_test.
+#ifndef CRYPTO3_CONTAINERS_WITH_POSEIDON_NODE_HASH
+#define CRYPTO3_CONTAINERS_WITH_POSEIDON_NODE_HASH
+#endif
+
 #include <nil/crypto3/algebra/random_element.hpp>
 #include <nil/crypto3/algebra/type_traits.hpp>
 #include <nil/crypto3/hash/block_to_field_elements_wrapper.hpp>
@@ -38,14 +43,31 @@
 
 #include <nil/crypto3/container/merkle/tree.hpp>
 #include <nil/crypto3/container/merkle/proof.hpp>
+#include <nil/crypto3/container/merkle/fixed_proof.hpp>
+#include <nil/crypto3/container/merkle/proof_batch.hpp>
+#include <nil/crypto3/container/merkle/multiproof.hpp>
+#include <nil/crypto3/container/merkle/sparse_tree.hpp>
+#include <nil/crypto3/container/merkle/cached_tree.hpp>
+#include <nil/crypto3/container/merkle/lazy_tree.hpp>
+#include <nil/crypto3/container/merkle/fixed_tree.hpp>
+#include <nil/crypto3/container/merkle/tree_batch.hpp>
+#include <nil/crypto3/container/merkle/builder.hpp>
+#include <nil/crypto3/container/merkle/mapped_storage.hpp>
+#include <nil/crypto3/container/merkle/serialization.hpp>
+#include <nil/crypto3/container/merkle/async.hpp>
+#include <nil/crypto3/container/merkle/distributed.hpp>
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
 #include <boost/test/data/monomorphic.hpp>
+#include <boost/filesystem.hpp>
 
 #include <chrono>
 #include <cstdio>
+#include <deque>
+#include <functional>
 #include <limits>
+#include <memory_resource>
 #include <type_traits>
 #include <nil/crypto3/hash/algorithm/hash.hpp>
 
@@ -160,10 +182,11 @@ void testing_validate_template_random_data_compressed_proofs(std::size_t leaf_nu
     auto sorted_idxs = proof_idxs;
     std::sort(sorted_idxs.begin(), sorted_idxs.end());
     std::size_t wrong_leaf_idx = 0;
+    // the smallest leaf not proven, skipping repeated indices
     for (auto idx : sorted_idxs) {
         if (idx == wrong_leaf_idx) {
             wrong_leaf_idx++;
-        } else {
+        } else if (idx > wrong_leaf_idx) {
             break;
         }
     }
@@ -222,10 +245,11 @@ void testing_validate_template_compressed_proofs(std::vector<Element> data) {
     auto sorted_idxs = proof_idxs;
     std::sort(sorted_idxs.begin(), sorted_idxs.end());
     std::size_t wrong_leaf_idx = 0;
+    // the smallest leaf not proven, skipping repeated indices
     for (auto idx : sorted_idxs) {
         if (idx == wrong_leaf_idx) {
             wrong_leaf_idx++;
-        } else {
+        } else if (idx > wrong_leaf_idx) {
             break;
         }
     }
@@ -253,6 +277,789 @@ void testing_hash_template(std::vector<Element> data, std::string result) {
     BOOST_CHECK(result == std::to_string(tree.root()));
 }
 
+template<typename Hash, size_t Arity, typename ValueType, std::size_t N>
+void testing_parallel_construction_template_random_data(std::size_t leaf_number) {
+    auto data = generate_random_data<ValueType, N>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+    for (std::size_t threads : {1, 2, 3, 8}) {
+        merkle_tree<Hash, Arity> parallel_tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end(), threads);
+        BOOST_CHECK_EQUAL(parallel_tree.size(), tree.size());
+        BOOST_CHECK_EQUAL(parallel_tree.row_count(), tree.row_count());
+        BOOST_CHECK(std::equal(tree.begin(), tree.end(), parallel_tree.begin()));
+    }
+}
+
+template<typename Hash, size_t Arity>
+void testing_batch_node_hasher_template(std::size_t groups) {
+    using digest_type = typename Hash::digest_type;
+    auto data = generate_random_data<std::uint8_t, 1>(groups * Arity);
+    std::vector<digest_type> children;
+    for (const auto &leaf : data) {
+        children.emplace_back(nil::crypto3::hash<Hash>(leaf));
+    }
+    std::vector<digest_type> batched(groups);
+    containers::detail::batch_node_hasher<Hash, Arity>::process(children.begin(), groups, batched.begin());
+    for (std::size_t i = 0; i < groups; ++i) {
+        auto it = children.begin() + i * Arity;
+        BOOST_CHECK(batched[i] == containers::detail::generate_hash<Hash>(it, it + Arity));
+    }
+}
+
+template<typename Hash, size_t Arity>
+void testing_mapped_storage_template(std::size_t leaf_number) {
+    using mapped_container_type = typename merkle_tree<Hash, Arity, mapped_storage>::container_type;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    {
+        merkle_tree<Hash, Arity, mapped_storage> mapped_tree =
+            make_merkle_tree<Hash, Arity, mapped_storage>(data.begin(), data.end(), mapped_container_type(path.string()));
+        BOOST_CHECK_EQUAL(mapped_tree.size(), tree.size());
+        BOOST_CHECK(std::equal(tree.begin(), tree.end(), mapped_tree.begin()));
+    }
+    BOOST_CHECK_EQUAL(boost::filesystem::file_size(path), tree.size() * sizeof(typename Hash::digest_type));
+
+    merkle_tree<Hash, Arity, mapped_storage> reopened_tree(
+        mapped_container_type(path.string(), mapping_mode::open_read_only));
+    BOOST_CHECK_EQUAL(reopened_tree.leaves(), tree.leaves());
+    BOOST_CHECK_EQUAL(reopened_tree.row_count(), tree.row_count());
+    BOOST_CHECK(reopened_tree.root() == tree.root());
+
+    std::size_t proof_idx = std::rand() % leaf_number;
+    merkle_proof<Hash, Arity> proof(reopened_tree, proof_idx);
+    BOOST_CHECK(proof == merkle_proof<Hash, Arity>(tree, proof_idx));
+    BOOST_CHECK(proof.validate(data[proof_idx]));
+
+    boost::filesystem::remove(path);
+}
+
+template<typename Hash, size_t Arity>
+void testing_cached_tree_template(std::size_t leaf_number) {
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    for (std::size_t rows_to_discard = 0; rows_to_discard + 1 < tree.row_count(); ++rows_to_discard) {
+        cached_merkle_tree<Hash, Arity> cached_tree =
+            make_cached_merkle_tree<Hash, Arity>(data.begin(), data.end(), rows_to_discard);
+        BOOST_CHECK_EQUAL(cached_tree.size(),
+                          leaf_number + containers::detail::merkle_tree_cache_size(leaf_number, Arity, rows_to_discard));
+        BOOST_CHECK(cached_tree.root() == tree.root());
+
+        std::size_t proof_idx = std::rand() % leaf_number;
+        merkle_proof<Hash, Arity> proof(cached_tree, proof_idx);
+        BOOST_CHECK(proof == merkle_proof<Hash, Arity>(tree, proof_idx));
+        BOOST_CHECK(proof.validate(data[proof_idx]));
+    }
+}
+
+template<typename Hash, std::size_t Arity>
+void testing_lazy_tree_template(std::size_t leaf_number) {
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    for (std::size_t cap_rows = 1; cap_rows < tree.row_count(); ++cap_rows) {
+        lazy_merkle_tree<Hash, Arity> lazy_tree =
+            make_lazy_merkle_tree<Hash, Arity>(data.begin(), data.end(), cap_rows, 2 * Arity);
+        BOOST_CHECK_EQUAL(lazy_tree.cap_row(), tree.row_count() - cap_rows);
+        BOOST_CHECK(!lazy_tree.is_cap_materialized());
+        BOOST_CHECK(lazy_tree.root() == tree.root());
+        BOOST_CHECK(lazy_tree.is_cap_materialized());
+
+        for (std::size_t row = 0, row_len = leaf_number; row < tree.row_count(); ++row, row_len /= Arity) {
+            for (std::size_t pos = 0; pos < row_len; ++pos) {
+                BOOST_CHECK(lazy_tree.node(row, pos) == tree.node(row, pos));
+                BOOST_CHECK(lazy_tree.cached_nodes() <= lazy_tree.cache_size());
+            }
+        }
+
+        std::size_t proof_idx = std::rand() % leaf_number;
+        merkle_proof<Hash, Arity> proof(lazy_tree, proof_idx);
+        BOOST_CHECK(proof == merkle_proof<Hash, Arity>(tree, proof_idx));
+        BOOST_CHECK(proof.validate(data[proof_idx]));
+    }
+
+    lazy_merkle_tree<Hash, Arity> uncached_tree = make_lazy_merkle_tree<Hash, Arity>(data.begin(), data.end(), 1, 0);
+    BOOST_CHECK(merkle_proof<Hash, Arity>(uncached_tree, 0) == merkle_proof<Hash, Arity>(tree, 0));
+    BOOST_CHECK_EQUAL(uncached_tree.cached_nodes(), 0);
+}
+
+template<typename Hash, size_t Arity>
+void testing_update_leaves_template(std::size_t leaf_number) {
+    using Element = std::array<std::uint8_t, 1>;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    std::size_t idx = std::rand() % leaf_number;
+    data[idx] = generate_random_data<std::uint8_t, 1>(1)[0];
+    tree.update_leaf(idx, data[idx]);
+    merkle_tree<Hash, Arity> rebuilt_tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+    BOOST_CHECK(std::equal(tree.begin(), tree.end(), rebuilt_tree.begin()));
+
+    // sparse, adjacent and repeated indices
+    std::vector<std::pair<std::size_t, Element>> updates;
+    for (std::size_t i : {std::size_t(0), std::size_t(1), leaf_number / 2, leaf_number - 1, std::size_t(1)}) {
+        updates.emplace_back(i, generate_random_data<std::uint8_t, 1>(1)[0]);
+    }
+    for (const auto &update : updates) {
+        data[update.first] = update.second;
+    }
+    tree.update_leaves(updates.begin(), updates.end());
+    rebuilt_tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+    BOOST_CHECK(std::equal(tree.begin(), tree.end(), rebuilt_tree.begin()));
+    BOOST_CHECK(merkle_proof<Hash, Arity>(tree, 1).validate(data[1]));
+}
+
+template<typename Hash, size_t Arity>
+void testing_streaming_builder_template(std::size_t leaf_number) {
+    using container_type = typename merkle_tree<Hash, Arity>::container_type;
+    using sink_type = merkle_tree_storage_sink<container_type, Arity>;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    merkle_tree_builder<Hash, Arity> root_builder;
+    for (std::size_t i = 0; i < leaf_number; ++i) {
+        std::size_t power = i;
+        while (power > 1 && power % Arity == 0) {
+            power /= Arity;
+        }
+        BOOST_CHECK_EQUAL(root_builder.is_complete(), power == 1);
+        root_builder.push(data[i]);
+    }
+    BOOST_CHECK(root_builder.is_complete());
+    BOOST_CHECK(root_builder.root() == tree.root());
+
+    merkle_tree_builder<Hash, Arity, sink_type> tree_builder(sink_type(leaf_number, container_type()));
+    tree_builder.push(data.begin(), data.begin() + leaf_number / 2);
+    tree_builder.push(data.begin() + leaf_number / 2, data.end());
+    // a stream longer than declared is rejected, the leaf pushed too many leaves the nodes as they were
+    BOOST_CHECK_THROW(tree_builder.push(data[0]), std::length_error);
+    BOOST_CHECK_THROW(tree_builder.push(data.begin(), data.begin() + 1, 2, 1), std::length_error);
+    BOOST_CHECK_EQUAL(tree_builder.leaves(), leaf_number);
+    BOOST_CHECK(tree_builder.root() == tree.root());
+    merkle_tree<Hash, Arity> streamed_tree(tree_builder.sink().release());
+    BOOST_CHECK_EQUAL(streamed_tree.size(), tree.size());
+    BOOST_CHECK(std::equal(tree.begin(), tree.end(), streamed_tree.begin()));
+
+    for (std::size_t threads : {1, 3}) {
+        merkle_tree_builder<Hash, Arity, sink_type> pipelined_builder(sink_type(leaf_number, container_type()));
+        pipelined_builder.push(data.begin(), data.begin() + leaf_number / 2, threads, 5);
+        pipelined_builder.push(data.begin() + leaf_number / 2, data.end(), threads, 1);
+        BOOST_CHECK_EQUAL(pipelined_builder.leaves(), leaf_number);
+        BOOST_CHECK(pipelined_builder.root() == tree.root());
+        merkle_tree<Hash, Arity> pipelined_tree(pipelined_builder.sink().release());
+        BOOST_CHECK(std::equal(tree.begin(), tree.end(), pipelined_tree.begin()));
+    }
+}
+
+static std::size_t counted_allocations = 0;
+
+template<typename T>
+struct counting_allocator {
+    typedef T value_type;
+
+    counting_allocator() = default;
+    template<typename U>
+    counting_allocator(const counting_allocator<U> &) {
+    }
+
+    T *allocate(std::size_t n) {
+        ++counted_allocations;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T *p, std::size_t n) {
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const counting_allocator<U> &) const {
+        return true;
+    }
+    template<typename U>
+    bool operator!=(const counting_allocator<U> &) const {
+        return false;
+    }
+};
+
+struct counting_storage {
+    template<typename T>
+    using container_type = std::vector<T, counting_allocator<T>>;
+};
+
+template<typename Hash, size_t Arity, typename Element>
+merkle_tree<Hash, Arity, counting_storage> make_counted_merkle_tree(const std::vector<Element> &data) {
+    // Named, so the result is returned through the move constructor.
+    merkle_tree<Hash, Arity, counting_storage> tree = make_merkle_tree<Hash, Arity, counting_storage>(
+        data.begin(), data.end(), typename merkle_tree<Hash, Arity, counting_storage>::container_type());
+    return tree;
+}
+
+template<typename Hash, size_t Arity>
+void testing_move_semantics_template(std::size_t leaf_number) {
+    using tree_type = merkle_tree<Hash, Arity, counting_storage>;
+    BOOST_STATIC_ASSERT(std::is_nothrow_move_constructible<tree_type>::value);
+    BOOST_STATIC_ASSERT(std::is_nothrow_move_assignable<tree_type>::value);
+
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> reference_tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    counted_allocations = 0;
+    tree_type tree = make_counted_merkle_tree<Hash, Arity>(data);
+    BOOST_CHECK_EQUAL(counted_allocations, 1);
+
+    std::vector<tree_type> trees;
+    trees.reserve(2);
+    trees.push_back(std::move(tree));
+    trees.emplace_back(std::move(trees.front()));
+    tree_type assigned_tree;
+    assigned_tree = std::move(trees.back());
+    BOOST_CHECK_EQUAL(counted_allocations, 1);
+
+    BOOST_CHECK(tree.empty());
+    BOOST_CHECK_EQUAL(assigned_tree.size(), reference_tree.size());
+    BOOST_CHECK_EQUAL(assigned_tree.leaves(), reference_tree.leaves());
+    BOOST_CHECK_EQUAL(assigned_tree.row_count(), reference_tree.row_count());
+    BOOST_CHECK(assigned_tree.root() == reference_tree.root());
+}
+
+template<typename Hash, size_t Arity>
+void testing_batch_proofs_template(std::size_t leaf_number) {
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    std::vector<std::size_t> leaf_idxs;
+    for (std::size_t i = 0; i < 3 * leaf_number; i += 5) {
+        leaf_idxs.emplace_back((i * 7) % leaf_number);
+    }
+
+    for (std::size_t threads : {std::size_t(1), std::size_t(4)}) {
+        merkle_proof_batch<Hash, Arity> proofs = generate_proofs(tree, leaf_idxs, threads);
+        BOOST_CHECK_EQUAL(proofs.size(), leaf_idxs.size());
+        BOOST_CHECK_EQUAL(proofs.layers().size(), leaf_idxs.size() * (tree.row_count() - 1));
+        for (std::size_t i = 0; i < proofs.size(); ++i) {
+            merkle_proof<Hash, Arity> expected(tree, leaf_idxs[i]);
+            merkle_proof<Hash, Arity> proof = proofs[i];
+            BOOST_CHECK(proof == expected);
+            BOOST_CHECK(proofs[i].validate(data[leaf_idxs[i]]));
+        }
+    }
+}
+
+template<typename Hash, size_t Arity>
+void testing_multiproof_template(std::size_t leaf_number) {
+    using Element = std::array<std::uint8_t, 1>;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    std::vector<std::size_t> leaf_idxs = {leaf_number - 1, 3, 4, 3, leaf_number / 2};
+    merkle_multiproof<Hash, Arity> proof = generate_multiproof(tree, leaf_idxs);
+    BOOST_CHECK_EQUAL(proof.leaf_indices().size(), 4);
+    std::vector<Element> leaves;
+    for (std::size_t idx : proof.leaf_indices()) {
+        leaves.emplace_back(data[idx]);
+    }
+    BOOST_CHECK(proof.validate(leaves));
+    leaves[1][0] ^= 1;
+    BOOST_CHECK(!proof.validate(leaves));
+    leaves.pop_back();
+    BOOST_CHECK(!proof.validate(leaves));
+
+    std::vector<std::size_t> single_leaf = {5};
+    merkle_multiproof<Hash, Arity> single_proof = generate_multiproof(tree, single_leaf);
+    BOOST_CHECK_EQUAL(single_proof.siblings().size(), (tree.row_count() - 1) * (Arity - 1));
+    BOOST_CHECK(single_proof.validate(std::vector<Element> {data[5]}));
+
+    std::vector<std::size_t> all_leaves(leaf_number);
+    std::iota(all_leaves.begin(), all_leaves.end(), 0);
+    merkle_multiproof<Hash, Arity> full_proof = generate_multiproof(tree, all_leaves);
+    BOOST_CHECK(full_proof.siblings().empty());
+    BOOST_CHECK(full_proof.validate(data));
+}
+
+template<typename Hash, size_t Arity>
+void testing_batch_verification_template(std::size_t leaf_number) {
+    using Element = std::array<std::uint8_t, 1>;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    // repeated and adjacent leaves share most of their paths
+    std::vector<std::size_t> leaf_idxs;
+    std::vector<Element> leaves;
+    for (std::size_t i = 0; i < 3 * leaf_number; i += 5) {
+        leaf_idxs.emplace_back((i * 7) % leaf_number);
+        leaves.emplace_back(data[leaf_idxs.back()]);
+    }
+    merkle_proof_batch<Hash, Arity> batch = generate_proofs(tree, leaf_idxs);
+    std::vector<merkle_proof<Hash, Arity>> proofs;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        proofs.emplace_back(batch[i]);
+    }
+    BOOST_CHECK(validate_all_proofs(proofs.begin(), proofs.end(), leaves.begin()));
+    BOOST_CHECK(validate_all_proofs(batch, leaves.begin(), 4));
+
+    leaves[7][0] ^= 1;
+    for (std::size_t threads : {std::size_t(1), std::size_t(4)}) {
+        std::vector<bool> results;
+        validate_proofs(proofs.begin(), proofs.end(), leaves.begin(), std::back_inserter(results), threads);
+        BOOST_CHECK_EQUAL(results.size(), proofs.size());
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            BOOST_CHECK_EQUAL(results[i], proofs[i].validate(leaves[i]));
+        }
+        BOOST_CHECK(!results[7]);
+    }
+    BOOST_CHECK(!validate_all_proofs(batch, leaves.begin()));
+}
+
+template<typename Hash, size_t Arity, size_t LeafNumber>
+void testing_fixed_tree_template() {
+    using geometry_type = containers::detail::merkle_tree_geometry<Arity, LeafNumber>;
+    BOOST_STATIC_ASSERT(geometry_type::length == containers::detail::merkle_tree_length(LeafNumber, Arity));
+    BOOST_STATIC_ASSERT(geometry_type::row_offsets[geometry_type::row_count - 1] == geometry_type::length - 1);
+
+    auto data = generate_random_data<std::uint8_t, 1>(LeafNumber);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+    fixed_merkle_tree<Hash, Arity, LeafNumber> fixed_tree =
+        make_fixed_merkle_tree<Hash, Arity, LeafNumber>(data.begin(), data.end());
+
+    BOOST_CHECK_EQUAL(fixed_tree.size(), tree.size());
+    BOOST_CHECK_EQUAL(fixed_tree.row_count(), tree.row_count());
+    BOOST_CHECK(std::equal(tree.begin(), tree.end(), fixed_tree.begin()));
+    for (std::size_t i = 0; i < LeafNumber; i += 3) {
+        merkle_proof<Hash, Arity> proof(fixed_tree, i);
+        BOOST_CHECK(proof == merkle_proof<Hash, Arity>(tree, i));
+        BOOST_CHECK(proof.validate(data[i]));
+    }
+}
+
+template<typename Hash, size_t Arity>
+void testing_fixed_proof_template(std::size_t leaf_number) {
+    using proof_type = fixed_merkle_proof<Hash, Arity, 8>;
+    BOOST_STATIC_ASSERT(std::is_trivially_destructible<proof_type>::value);
+
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+    for (std::size_t i = 0; i < leaf_number; i += 3) {
+        proof_type proof(tree, i);
+        merkle_proof<Hash, Arity> regular_proof(tree, i);
+        BOOST_CHECK_EQUAL(proof.depth(), tree.row_count() - 1);
+        BOOST_CHECK(proof.validate(data[i]));
+        BOOST_CHECK(static_cast<merkle_proof<Hash, Arity>>(proof) == regular_proof);
+        BOOST_CHECK(proof_type(regular_proof) == proof);
+    }
+
+    // a modified leaf does not validate
+    proof_type proof(tree, 0);
+    auto other_data = data[0];
+    other_data[0] ^= 1;
+    BOOST_CHECK(!proof.validate(other_data));
+
+    // trees and proofs deeper than the capacity, positions disagreeing with the leaf index
+    using shallow_proof_type = fixed_merkle_proof<Hash, Arity, 1>;
+    using regular_proof_type = merkle_proof<Hash, Arity>;
+    regular_proof_type regular_proof(tree, 1);
+    BOOST_CHECK_THROW(shallow_proof_type(tree, 1).depth(), std::length_error);
+    BOOST_CHECK_THROW(shallow_proof_type(regular_proof).depth(), std::length_error);
+
+    typename regular_proof_type::path_type path = regular_proof.path();
+    path[1][0]._position = Arity;
+    regular_proof_type mismatched_proof(regular_proof.leaf_index(), regular_proof.root(), path);
+    BOOST_CHECK_THROW(proof_type(mismatched_proof).depth(), std::invalid_argument);
+
+    // a leaf index with digits above the path: same siblings, forged index
+    regular_proof_type forged_proof(regular_proof.leaf_index() + leaf_number, regular_proof.root(),
+                                    regular_proof.path());
+    BOOST_CHECK_THROW(proof_type(forged_proof).depth(), std::invalid_argument);
+    BOOST_CHECK_THROW(proof_type(tree, leaf_number).depth(), std::out_of_range);
+}
+
+template<typename Hash, size_t Arity, size_t Levels>
+void testing_blocked_layout_template(std::size_t leaf_number) {
+    using layout_type = subtree_blocked_layout<Levels>;
+    using tree_type = merkle_tree<Hash, Arity, vector_storage, layout_type>;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+    tree_type blocked_tree = make_merkle_tree<Hash, Arity, vector_storage, layout_type>(
+        data.begin(), data.end(), typename tree_type::container_type());
+
+    BOOST_CHECK_EQUAL(blocked_tree.size(), tree.size());
+    BOOST_CHECK(blocked_tree.root() == tree.root());
+    std::vector<bool> used(tree.size(), false);
+    for (std::size_t row = 0, row_len = leaf_number; row < tree.row_count(); ++row, row_len /= Arity) {
+        for (std::size_t pos = 0; pos < row_len; ++pos) {
+            BOOST_CHECK(blocked_tree.node(row, pos) == tree.node(row, pos));
+            BOOST_CHECK(!used[blocked_tree.node_index(row, pos)]);
+            used[blocked_tree.node_index(row, pos)] = true;
+        }
+    }
+    for (std::size_t i = 0; i < leaf_number; i += 7) {
+        BOOST_CHECK(merkle_proof<Hash, Arity>(blocked_tree, i) == merkle_proof<Hash, Arity>(tree, i));
+    }
+
+    std::vector<std::pair<std::size_t, std::array<std::uint8_t, 1>>> updates;
+    for (std::size_t i : {std::size_t(1), std::size_t(2), leaf_number / 2, leaf_number - 1}) {
+        updates.emplace_back(i, generate_random_data<std::uint8_t, 1>(1)[0]);
+    }
+    tree.update_leaves(updates.begin(), updates.end());
+    blocked_tree.update_leaves(updates.begin(), updates.end());
+    tree.update_leaf(3, updates[0].second);
+    blocked_tree.update_leaf(3, updates[0].second);
+    BOOST_CHECK(blocked_tree.root() == tree.root());
+}
+
+template<typename Hash>
+void testing_sparse_tree_template() {
+    using Element = std::array<std::uint8_t, 1>;
+    using small_tree_type = sparse_merkle_tree<Hash, 6>;
+    using key_type = typename small_tree_type::key_type;
+
+    // a full sparse tree is the dense tree
+    auto data = generate_random_data<std::uint8_t, 1>(64);
+    merkle_tree<Hash, 2> tree = make_merkle_tree<Hash, 2>(data.begin(), data.end());
+    std::vector<std::pair<key_type, Element>> updates;
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        updates.emplace_back(small_tree_type::make_key(i), data[i]);
+    }
+    small_tree_type small_tree;
+    small_tree.insert(updates.begin(), updates.begin() + 20);
+    for (auto it = updates.begin() + 20; it != updates.end(); ++it) {
+        small_tree.insert(it->first, it->second);
+    }
+    BOOST_CHECK_EQUAL(small_tree.leaves(), data.size());
+    BOOST_CHECK_EQUAL(small_tree.size(), tree.size());
+    BOOST_CHECK(small_tree.root() == tree.root());
+    for (std::size_t i = 0; i < data.size(); i += 5) {
+        key_type key = small_tree_type::make_key(i);
+        merkle_proof<Hash, 2> proof = small_tree.proof(key);
+        BOOST_CHECK(proof == merkle_proof<Hash, 2>(tree, i));
+        BOOST_CHECK(small_tree_type::validate(proof, key, data[i]));
+        BOOST_CHECK(!small_tree_type::validate(proof, small_tree_type::make_key(i ^ 1), data[i]));
+    }
+
+    using tree_type = sparse_merkle_tree<Hash, 256>;
+    tree_type sparse_tree;
+    const auto empty_root = sparse_tree.root();
+    BOOST_CHECK(empty_root == sparse_tree.empty_hash(256));
+
+    typename tree_type::key_type high_key = tree_type::make_key(12345), low_key = tree_type::make_key(7);
+    high_key[0] = 0xab;
+    sparse_tree.insert(high_key, data[1]);
+    sparse_tree.insert(low_key, data[2]);
+    // two paths sharing the root only
+    BOOST_CHECK_EQUAL(sparse_tree.size(), 2 * 256 + 1);
+    BOOST_CHECK(sparse_tree.contains(high_key));
+    BOOST_CHECK(tree_type::validate(sparse_tree.proof(high_key), high_key, data[1]));
+    BOOST_CHECK(!tree_type::validate_non_membership(sparse_tree.proof(high_key), high_key));
+    typename tree_type::key_type absent_key = tree_type::make_key(8);
+    BOOST_CHECK(!sparse_tree.contains(absent_key));
+    BOOST_CHECK(tree_type::validate_non_membership(sparse_tree.proof(absent_key), absent_key));
+
+    std::vector<typename tree_type::key_type> keys = {high_key, low_key};
+    sparse_tree.erase(keys.begin(), keys.end());
+    BOOST_CHECK_EQUAL(sparse_tree.leaves(), 0);
+    BOOST_CHECK_EQUAL(sparse_tree.size(), 0);
+    BOOST_CHECK(sparse_tree.root() == empty_root);
+}
+
+template<typename Hash, std::size_t Arity>
+void testing_tree_batch_template(std::size_t trees, std::size_t leaf_number, std::size_t threads) {
+    auto data = generate_random_data<std::uint8_t, 1>(trees * leaf_number);
+    merkle_tree_batch<Hash, Arity> batch = make_merkle_tree_batch<Hash, Arity>(data.begin(), data.end(), trees, threads);
+    BOOST_CHECK_EQUAL(batch.trees(), trees);
+    BOOST_CHECK_EQUAL(batch.leaves(), leaf_number);
+
+    for (std::size_t t = 0; t < trees; ++t) {
+        auto first = data.begin() + t * leaf_number;
+        merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(first, first + leaf_number);
+        auto view = batch[t];
+        BOOST_CHECK_EQUAL(view.row_count(), tree.row_count());
+        BOOST_CHECK_EQUAL(view.size(), tree.size());
+        BOOST_CHECK(view.root() == tree.root());
+        for (std::size_t row = 0, row_len = leaf_number; row < tree.row_count(); ++row, row_len /= Arity) {
+            for (std::size_t pos = 0; pos < row_len; ++pos) {
+                BOOST_CHECK(view.node(row, pos) == tree.node(row, pos));
+            }
+        }
+
+        std::size_t proof_idx = std::rand() % leaf_number;
+        merkle_proof<Hash, Arity> proof(view, proof_idx);
+        BOOST_CHECK(proof == merkle_proof<Hash, Arity>(tree, proof_idx));
+        BOOST_CHECK(proof.validate(data[t * leaf_number + proof_idx]));
+    }
+}
+
+template<typename Hash, std::size_t Arity>
+void testing_reload_template(std::size_t leaf_number) {
+    typedef merkle_tree<Hash, Arity> tree_type;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    tree_type tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    std::vector<typename tree_type::value_type> hashes(tree.begin(), tree.end());
+    tree_type copied(hashes.begin(), hashes.end());
+    BOOST_CHECK(copied == tree);
+    BOOST_CHECK_EQUAL(copied.leaves(), leaf_number);
+    BOOST_CHECK_EQUAL(copied.row_count(), tree.row_count());
+    BOOST_CHECK_EQUAL(copied.complete_size(), tree.size());
+    BOOST_CHECK(copied.root() == tree.root());
+
+    const typename tree_type::value_type *buffer = hashes.data();
+    tree_type adopted {std::vector<typename tree_type::value_type>(hashes)};
+    tree_type adopted_with_leaves(std::move(hashes), leaf_number);
+    BOOST_CHECK(adopted == tree);
+    BOOST_CHECK(adopted_with_leaves == tree);
+    BOOST_CHECK(adopted_with_leaves.hashes() == buffer);
+    BOOST_CHECK(adopted_with_leaves.get_allocator() == tree.get_allocator());
+
+    merkle_proof<Hash, Arity> proof(adopted, leaf_number / 2);
+    BOOST_CHECK(proof.validate(data[leaf_number / 2]));
+
+    adopted.update_leaf(0, std::array<std::uint8_t, 1> {static_cast<std::uint8_t>(data[0][0] + 1)});
+    BOOST_CHECK(adopted != tree);
+
+    // buffers which are not a complete tree are rejected, in release builds too
+    typedef std::vector<typename tree_type::value_type> buffer_type;
+    const buffer_type complete(tree.begin(), tree.end());
+    buffer_type overlong = complete;
+    overlong.emplace_back(tree.root());
+    BOOST_CHECK_THROW(tree_type(buffer_type(complete.begin(), complete.end() - 1)).size(), std::invalid_argument);
+    BOOST_CHECK_THROW(tree_type(buffer_type(overlong)).size(), std::invalid_argument);
+    BOOST_CHECK_THROW(tree_type(complete.begin() + 1, complete.end()).size(), std::invalid_argument);
+    BOOST_CHECK_THROW(tree_type(buffer_type(complete), leaf_number + 1).size(), std::invalid_argument);
+    BOOST_CHECK_THROW(tree_type(buffer_type(complete), leaf_number * Arity).size(), std::invalid_argument);
+    BOOST_CHECK_THROW(tree_type(buffer_type(overlong), leaf_number).size(), std::invalid_argument);
+}
+
+template<typename Hash, std::size_t Arity>
+void testing_allocator_template(std::size_t leaf_number) {
+    typedef basic_vector_storage<std::pmr::polymorphic_allocator<void>> storage_type;
+    typedef merkle_tree<Hash, Arity, storage_type> tree_type;
+    typedef merkle_proof<Hash, Arity, std::pmr::polymorphic_allocator<void>> proof_type;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+
+    std::pmr::monotonic_buffer_resource arena;
+    typename tree_type::container_type buffer {typename tree_type::allocator_type(&arena)};
+    tree_type tree = make_merkle_tree<Hash, Arity, storage_type>(data.begin(), data.end(), std::move(buffer));
+    BOOST_CHECK(tree.get_allocator().resource() == &arena);
+    BOOST_CHECK(tree.root() == make_merkle_tree<Hash, Arity>(data.begin(), data.end()).root());
+
+    std::size_t proof_idx = std::rand() % leaf_number;
+    proof_type proof(tree, proof_idx, typename proof_type::allocator_type(&arena));
+    BOOST_CHECK(proof.get_allocator().resource() == &arena);
+    BOOST_CHECK_EQUAL(proof.path().size(), tree.row_count() - 1);
+    BOOST_CHECK(proof.validate(data[proof_idx]));
+    BOOST_CHECK(!proof.validate(std::array<std::uint8_t, 1> {static_cast<std::uint8_t>(data[proof_idx][0] + 1)}));
+}
+
+template<typename Hash, std::size_t Arity>
+void testing_serialization_template(std::size_t leaf_number) {
+    using blocked_layout_type = subtree_blocked_layout<2>;
+    using view_type = merkle_tree_view<Hash, Arity>;
+    using proof_view_type = merkle_proof_view<Hash, Arity>;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+    merkle_tree<Hash, Arity, vector_storage, blocked_layout_type> blocked_tree =
+        make_merkle_tree<Hash, Arity, vector_storage, blocked_layout_type>(
+            data.begin(), data.end(), typename merkle_tree<Hash, Arity>::container_type());
+
+    std::vector<std::uint8_t> buffer = serialize(tree);
+    BOOST_CHECK_EQUAL(buffer.size(), serialized_size(tree));
+    BOOST_CHECK(serialize(blocked_tree) == buffer);
+
+    view_type view(buffer.data(), buffer.size());
+    BOOST_CHECK_EQUAL(view.leaves(), leaf_number);
+    BOOST_CHECK_EQUAL(view.row_count(), tree.row_count());
+    BOOST_CHECK_EQUAL(view.size(), tree.size());
+    BOOST_CHECK(view.root() == tree.root());
+    BOOST_CHECK(std::equal(view.begin(), view.end(), tree.begin()));
+    BOOST_CHECK(load_merkle_tree(view) == tree);
+    BOOST_CHECK(load_merkle_tree<vector_storage, blocked_layout_type>(view) == blocked_tree);
+
+    for (std::size_t i = 0; i < leaf_number; i += leaf_number / 8 + 1) {
+        merkle_proof<Hash, Arity> proof(tree, i);
+        BOOST_CHECK(generate_proof(view, i) == proof);
+
+        std::vector<std::uint8_t> proof_buffer = serialize(proof);
+        BOOST_CHECK_EQUAL(proof_buffer.size(), serialized_size(proof));
+        proof_view_type proof_view(proof_buffer.data(), proof_buffer.size());
+        BOOST_CHECK_EQUAL(proof_view.leaf_index(), i);
+        BOOST_CHECK_EQUAL(proof_view.depth(), tree.row_count() - 1);
+        BOOST_CHECK(proof_view.root() == tree.root());
+        BOOST_CHECK(proof_view.validate(data[i]));
+        BOOST_CHECK(!proof_view.validate(std::array<std::uint8_t, 1> {static_cast<std::uint8_t>(data[i][0] + 1)}));
+        BOOST_CHECK(load_merkle_proof(proof_view) == proof);
+    }
+
+    BOOST_CHECK_THROW(view_type(buffer.data(), buffer.size() - 1), std::invalid_argument);
+    BOOST_CHECK_THROW(view_type(buffer.data(), 16), std::invalid_argument);
+    BOOST_CHECK_THROW(proof_view_type(buffer.data(), buffer.size()), std::invalid_argument);
+
+    // leaf indices from leaf_number on, e.g. with a high digit set, are rejected
+    std::vector<std::uint8_t> proof_buffer = serialize(merkle_proof<Hash, Arity>(tree, leaf_number - 1));
+    std::vector<std::uint8_t> out_of_range = proof_buffer;
+    out_of_range[16] = 0;
+    out_of_range[23] = 0x80;
+    BOOST_CHECK_THROW(proof_view_type(out_of_range.data(), out_of_range.size()), std::invalid_argument);
+    out_of_range = proof_buffer;
+    const std::uint64_t first_out_of_range = leaf_number;
+    for (std::size_t i = 0; i < 8; ++i) {
+        out_of_range[16 + i] = static_cast<std::uint8_t>(first_out_of_range >> (8 * i));
+    }
+    BOOST_CHECK_THROW(proof_view_type(out_of_range.data(), out_of_range.size()), std::invalid_argument);
+
+    buffer[4] = merkle_serialization_version + 1;
+    BOOST_CHECK_THROW(view_type(buffer.data(), buffer.size()), std::invalid_argument);
+}
+
+// Runs posted tasks when asked to, like a reactor loop.
+struct queue_executor {
+    void operator()(std::function<void()> task) const {
+        tasks->push_back(std::move(task));
+    }
+
+    std::size_t run(std::size_t max_tasks = std::numeric_limits<std::size_t>::max()) const {
+        std::size_t ran = 0;
+        for (; !tasks->empty() && ran < max_tasks; ++ran) {
+            std::function<void()> task = std::move(tasks->front());
+            tasks->pop_front();
+            task();
+        }
+        return ran;
+    }
+
+    std::shared_ptr<std::deque<std::function<void()>>> tasks =
+        std::make_shared<std::deque<std::function<void()>>>();
+};
+
+template<typename Hash, std::size_t Arity>
+void testing_async_template(std::size_t leaf_number) {
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+    queue_executor executor;
+
+    for (std::size_t chunk_size : {1, 7, 1 << 20}) {
+        for (std::size_t threads : {1, 3}) {
+            async_options options;
+            options.chunk_size = chunk_size;
+            options.threads = threads;
+            std::size_t last_completed = 0, total = 0;
+            options.progress = [&](std::size_t completed, std::size_t all) {
+                BOOST_CHECK(completed > last_completed);
+                last_completed = completed;
+                total = all;
+            };
+            std::future<merkle_tree<Hash, Arity>> built =
+                async_make_merkle_tree<Hash, Arity>(data.begin(), data.end(), executor, options);
+            BOOST_CHECK_EQUAL(executor.run(), (tree.size() + chunk_size - 1) / chunk_size);
+            BOOST_CHECK(built.get() == tree);
+            BOOST_CHECK_EQUAL(last_completed, tree.size());
+            BOOST_CHECK_EQUAL(total, tree.size());
+        }
+    }
+
+    async_options cancellable;
+    cancellable.chunk_size = 1;
+    bool completed = false;
+    async_make_merkle_tree<Hash, Arity>(data.begin(), data.end(), executor,
+                                        [&completed](std::exception_ptr error, merkle_tree<Hash, Arity>) {
+                                            completed = true;
+                                            BOOST_CHECK_THROW(std::rethrow_exception(error), async_cancelled);
+                                        },
+                                        cancellable);
+    executor.run(3);
+    BOOST_CHECK(!completed);
+    cancellable.cancellation.cancel();
+    BOOST_CHECK_EQUAL(executor.run(), 1);
+    BOOST_CHECK(completed);
+
+    std::vector<merkle_proof<Hash, Arity>> proofs;
+    for (std::size_t i = 0; i < leaf_number; ++i) {
+        proofs.emplace_back(tree, i);
+    }
+    async_options options;
+    options.chunk_size = 5;
+    std::future<bool> valid = async_validate(proofs.begin(), proofs.end(), data.begin(), executor, options);
+    executor.run();
+    BOOST_CHECK(valid.get());
+    std::swap(proofs.front(), proofs.back());
+    std::future<bool> invalid = async_validate(proofs.begin(), proofs.end(), data.begin(), executor, options);
+    BOOST_CHECK_EQUAL(executor.run(), 1);
+    BOOST_CHECK(!invalid.get());
+
+    std::vector<std::size_t> proof_idxs = {0, leaf_number / 2, leaf_number - 1};
+    std::vector<std::array<std::uint8_t, 1>> proof_leaves = {data[0], data[leaf_number / 2], data[leaf_number - 1]};
+    std::vector<merkle_proof<Hash, Arity>> compressed_proofs =
+        merkle_proof<Hash, Arity>::generate_compressed_proofs(tree, proof_idxs);
+    bool compressed_valid = false;
+    async_validate_compressed_proofs(compressed_proofs, proof_leaves, executor,
+                                     [&compressed_valid](std::exception_ptr error, bool result) {
+                                         compressed_valid = !error && result;
+                                     });
+    executor.run();
+    BOOST_CHECK(compressed_valid);
+}
+
+template<typename Hash, std::size_t Arity>
+void testing_distributed_template(std::size_t subtree_number, std::size_t subtree_leaf_number) {
+    using summary_type = merkle_subtree_summary<typename merkle_tree<Hash, Arity>::value_type>;
+    using top_tree_type = merkle_top_tree<Hash, Arity>;
+    auto data = generate_random_data<std::uint8_t, 1>(subtree_number * subtree_leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    std::vector<merkle_tree<Hash, Arity>> subtrees;
+    std::vector<summary_type> summaries;
+    for (std::size_t k = 0; k < subtree_number; ++k) {
+        auto first = data.begin() + k * subtree_leaf_number;
+        subtrees.emplace_back(make_merkle_tree<Hash, Arity>(first, first + subtree_leaf_number));
+        summaries.emplace_back(export_merkle_subtree(subtrees.back(), k));
+    }
+    std::reverse(summaries.begin(), summaries.end());
+
+    top_tree_type top = make_merkle_top_tree<Hash, Arity>(summaries.begin(), summaries.end());
+    BOOST_CHECK_EQUAL(top.subtrees(), subtree_number);
+    BOOST_CHECK_EQUAL(top.leaves(), tree.leaves());
+    BOOST_CHECK_EQUAL(top.row_count(), tree.row_count());
+    BOOST_CHECK(top.root() == tree.root());
+
+    for (std::size_t i = 0; i < tree.leaves(); i += subtree_leaf_number / 2 + 1) {
+        merkle_proof<Hash, Arity> proof = top.proof(subtrees[i / subtree_leaf_number], i);
+        BOOST_CHECK(proof == merkle_proof<Hash, Arity>(tree, i));
+        BOOST_CHECK(proof.validate(data[i]));
+    }
+
+    summaries.pop_back();
+    BOOST_CHECK_THROW(top_tree_type(summaries.begin(), summaries.end()), std::invalid_argument);
+}
+
+template<typename Hash, std::size_t Arity>
+void testing_path_iterator_template(std::size_t leaf_number) {
+    using path_iterator = containers::detail::merkle_path_iterator<Arity>;
+    auto data = generate_random_data<std::uint8_t, 1>(leaf_number);
+    merkle_tree<Hash, Arity> tree = make_merkle_tree<Hash, Arity>(data.begin(), data.end());
+
+    for (std::size_t leaf = 0; leaf < leaf_number; ++leaf) {
+        merkle_proof<Hash, Arity> proof(tree, leaf);
+        path_iterator it(leaf);
+        for (std::size_t row = 0, pos = leaf; row < tree.row_count(); ++row, pos /= Arity, ++it) {
+            BOOST_CHECK_EQUAL(it.row(), row);
+            BOOST_CHECK_EQUAL(it.position(), pos);
+            BOOST_CHECK_EQUAL(it.child_index(), pos % Arity);
+            BOOST_CHECK_EQUAL(it.group_begin(), pos - pos % Arity);
+            if (row == proof.path().size()) {
+                continue;
+            }
+            const auto &layer = proof.path()[row];
+            BOOST_CHECK_EQUAL(containers::detail::merkle_path_child_index<Arity>(layer), pos % Arity);
+            for (std::size_t i = 0; i < Arity - 1; ++i) {
+                BOOST_CHECK_EQUAL(it.sibling_index(i), i < pos % Arity ? i : i + 1);
+                BOOST_CHECK_EQUAL(it.sibling(i), it.group_begin() + it.sibling_index(i));
+                BOOST_CHECK_EQUAL(layer[i].position(), it.sibling_index(i));
+                BOOST_CHECK(layer[i].hash() == tree.node(row, it.sibling(i)));
+            }
+        }
+        BOOST_CHECK(proof.validate(data[leaf]));
+        BOOST_CHECK(!proof.validate(data[(leaf + 1) % leaf_number]) || data[leaf] == data[(leaf + 1) % leaf_number]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE(containers_merkltree_test)
 
 using curve_type = algebra::curves::pallas;
@@ -260,6 +1067,43 @@ using field_type = typename curve_type::base_field_type;
 using poseidon_type = hashes::poseidon<nil::crypto3::hashes::detail::mina_poseidon_policy<field_type>>;
 using original_poseidon_type = hashes::original_poseidon<nil::crypto3::hashes::detail::mina_poseidon_policy<field_type>>;
 
+// Parent of [first, last) through the Poseidon accumulator, bypassing merkle_node_hash.
+template<typename InputIterator>
+poseidon_type::digest_type poseidon_accumulator_node(InputIterator first, InputIterator last) {
+    accumulator_set<poseidon_type> acc;
+    for (; first != last; ++first) {
+        crypto3::hash<poseidon_type>(*first, acc);
+    }
+    return accumulators::extract::hash<poseidon_type>(acc);
+}
+
+// Root and proofs of a Poseidon tree against a root folded with the accumulator.
+template<std::size_t Arity>
+void testing_poseidon_tree_template(std::size_t leaf_number) {
+    std::vector<std::array<poseidon_type::word_type, 1>> leaves;
+    for (std::size_t i = 0; i < leaf_number; ++i) {
+        leaves.push_back({algebra::random_element<field_type>()});
+    }
+    merkle_tree<poseidon_type, Arity> tree = make_merkle_tree<poseidon_type, Arity>(leaves.begin(), leaves.end());
+
+    std::vector<poseidon_type::digest_type> row, parents;
+    for (const auto &leaf : leaves) {
+        row.emplace_back(crypto3::hash<poseidon_type>(leaf));
+    }
+    for (; row.size() > 1; row.swap(parents)) {
+        parents.clear();
+        for (std::size_t i = 0; i < row.size(); i += Arity) {
+            parents.emplace_back(poseidon_accumulator_node(row.begin() + i, row.begin() + i + Arity));
+        }
+    }
+    BOOST_CHECK(tree.root() == row.front());
+
+    for (std::size_t i = 0; i < leaf_number; i += Arity + 1) {
+        merkle_proof<poseidon_type, Arity> proof(tree, i);
+        BOOST_CHECK(proof.validate(leaves[i]));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(merkletree_construct_test_1) {
     std::vector<std::array<char, 1>> v = {{'0'}, {'1'}, {'2'}, {'3'}, {'4'}, {'5'}, {'6'}, {'7'}};
     merkle_tree<hashes::sha2<256>, 2> tree_res = make_merkle_tree<hashes::sha2<256>, 2>(v.begin(), v.end());
@@ -278,6 +1122,12 @@ BOOST_AUTO_TEST_CASE(merkletree_construct_test_2) {
     BOOST_CHECK_EQUAL(tree.row_count(), 3);
 }
 
+BOOST_AUTO_TEST_CASE(merkletree_reload_test) {
+    testing_reload_template<hashes::sha2<256>, 2>(64);
+    testing_reload_template<hashes::sha2<256>, 3>(81);
+    testing_reload_template<hashes::blake2b<224>, 4>(256);
+}
+
 
 BOOST_AUTO_TEST_CASE(merkletree_validate_test_1) {
     std::vector<std::array<char, 1>> v = {{'0'}, {'1'}, {'2'}, {'3'}, {'4'}, {'5'}, {'6'}, {'7'}};
@@ -397,4 +1247,197 @@ BOOST_AUTO_TEST_CASE(merkletree_hash_test_2) {
     testing_hash_template<hashes::blake2b<224>, 3>(v, "d9d0ff26d10aaac2882c08eb2b55e78690c949d1a73b1cfc0eb322ee");
 }
 
+BOOST_AUTO_TEST_CASE(merkletree_parallel_construct_test) {
+    testing_parallel_construction_template_random_data<hashes::sha2<256>, 2, std::uint8_t, 1>(256);
+    testing_parallel_construction_template_random_data<hashes::sha2<256>, 3, std::uint8_t, 1>(81);
+    testing_parallel_construction_template_random_data<hashes::blake2b<224>, 4, std::uint8_t, 1>(256);
+    testing_parallel_construction_template_random_data<poseidon_type, 2, poseidon_type::word_type, 1>(64);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_batch_node_hasher_test) {
+    testing_batch_node_hasher_template<hashes::sha2<256>, 2>(67);
+    testing_batch_node_hasher_template<hashes::sha2<256>, 3>(29);
+    testing_batch_node_hasher_template<hashes::sha2<256>, 4>(17);
+    testing_batch_node_hasher_template<hashes::blake2b<224>, 2>(9);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_mapped_storage_test) {
+    testing_mapped_storage_template<hashes::sha2<256>, 2>(64);
+    testing_mapped_storage_template<hashes::sha2<256>, 3>(27);
+    testing_mapped_storage_template<hashes::blake2b<224>, 4>(64);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_cached_tree_test) {
+    testing_cached_tree_template<hashes::sha2<256>, 2>(64);
+    testing_cached_tree_template<hashes::sha2<256>, 3>(81);
+    testing_cached_tree_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_lazy_tree_test) {
+    testing_lazy_tree_template<hashes::sha2<256>, 2>(64);
+    testing_lazy_tree_template<hashes::sha2<256>, 3>(81);
+    testing_lazy_tree_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_update_leaves_test) {
+    testing_update_leaves_template<hashes::sha2<256>, 2>(64);
+    testing_update_leaves_template<hashes::sha2<256>, 3>(81);
+    testing_update_leaves_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_streaming_builder_test) {
+    testing_streaming_builder_template<hashes::sha2<256>, 2>(64);
+    testing_streaming_builder_template<hashes::sha2<256>, 3>(81);
+    testing_streaming_builder_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_move_semantics_test) {
+    testing_move_semantics_template<hashes::sha2<256>, 2>(64);
+    testing_move_semantics_template<hashes::blake2b<224>, 3>(81);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_batch_proofs_test) {
+    testing_batch_proofs_template<hashes::sha2<256>, 2>(64);
+    testing_batch_proofs_template<hashes::sha2<256>, 3>(81);
+    testing_batch_proofs_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_multiproof_test) {
+    testing_multiproof_template<hashes::sha2<256>, 2>(64);
+    testing_multiproof_template<hashes::sha2<256>, 3>(81);
+    testing_multiproof_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_batch_verification_test) {
+    testing_batch_verification_template<hashes::sha2<256>, 2>(64);
+    testing_batch_verification_template<hashes::sha2<256>, 3>(81);
+    testing_batch_verification_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_geometry_test) {
+    using containers::detail::merkle_tree_arity;
+    BOOST_STATIC_ASSERT(containers::detail::next_pow2(65) == 128);
+    BOOST_STATIC_ASSERT(containers::detail::log2_pow2(64) == 6);
+    BOOST_STATIC_ASSERT(containers::detail::is_power_of(81, 3));
+    BOOST_STATIC_ASSERT(!containers::detail::is_power_of(82, 3));
+    BOOST_STATIC_ASSERT(containers::detail::merkle_tree_row_count(1, 2) == 1);
+    BOOST_STATIC_ASSERT(containers::detail::merkle_tree_row_count(64, 2) == 7);
+    BOOST_STATIC_ASSERT(containers::detail::merkle_tree_row_count(81, 3) == 5);
+    BOOST_STATIC_ASSERT(containers::detail::merkle_tree_row_count(256, 4) == 5);
+    BOOST_STATIC_ASSERT(containers::detail::merkle_tree_leaves(containers::detail::merkle_tree_length(81, 3), 3) == 81);
+    BOOST_STATIC_ASSERT(containers::detail::merkle_tree_length(256, 4) == 341);
+    BOOST_STATIC_ASSERT(containers::detail::merkle_tree_leaves(341, 4) == 256);
+    BOOST_STATIC_ASSERT(containers::detail::merkle_tree_length(1, 8) == 1);
+    BOOST_STATIC_ASSERT(containers::detail::is_merkle_tree_size_valid(64, 4));
+    BOOST_STATIC_ASSERT(!containers::detail::is_merkle_tree_size_valid(32, 4));
+    BOOST_STATIC_ASSERT(merkle_tree_arity<4>::parent(13) == 3 && merkle_tree_arity<4>::child_index(13) == 1);
+    BOOST_STATIC_ASSERT(merkle_tree_arity<3>::parent(13) == 4 && merkle_tree_arity<3>::child_index(13) == 1);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_fixed_tree_test) {
+    testing_fixed_tree_template<hashes::sha2<256>, 2, 64>();
+    testing_fixed_tree_template<hashes::sha2<256>, 3, 81>();
+    testing_fixed_tree_template<hashes::blake2b<224>, 4, 256>();
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_fixed_proof_test) {
+    testing_fixed_proof_template<hashes::sha2<256>, 2>(64);
+    testing_fixed_proof_template<hashes::sha2<256>, 3>(81);
+    testing_fixed_proof_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_blocked_layout_test) {
+    testing_blocked_layout_template<hashes::sha2<256>, 2, 1>(64);
+    testing_blocked_layout_template<hashes::sha2<256>, 2, 4>(1024);
+    testing_blocked_layout_template<hashes::sha2<256>, 3, 2>(81);
+    testing_blocked_layout_template<hashes::blake2b<224>, 4, 3>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_sparse_tree_test) {
+    testing_sparse_tree_template<hashes::sha2<256>>();
+    testing_sparse_tree_template<hashes::blake2b<224>>();
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_tree_batch_test) {
+    testing_tree_batch_template<hashes::sha2<256>, 2>(7, 16, 1);
+    testing_tree_batch_template<hashes::sha2<256>, 2>(5, 64, 4);
+    testing_tree_batch_template<hashes::sha2<256>, 3>(3, 27, 2);
+    testing_tree_batch_template<hashes::blake2b<224>, 4>(4, 64, 3);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_instrumentation_test) {
+    std::vector<std::array<char, 1>> v = {{'0'}, {'1'}, {'2'}, {'3'}, {'4'}, {'5'}, {'6'}, {'7'}};
+
+    reset_instrumentation();
+    auto tree = make_merkle_tree<hashes::blake2b<224>, 2>(v.begin(), v.end());
+    instrumentation_counters build = instrumentation_snapshot();
+
+    merkle_proof<hashes::blake2b<224>, 2> proof(tree, 5);
+    reset_instrumentation();
+    BOOST_CHECK(proof.validate(v[5]));
+    instrumentation_counters validation = instrumentation_snapshot();
+
+#ifdef CRYPTO3_CONTAINERS_INSTRUMENTATION
+    BOOST_CHECK_EQUAL(build.tree_builds, 1);
+    BOOST_CHECK_EQUAL(build.hash_invocations, tree.size());
+    BOOST_CHECK_EQUAL(build.accumulator_constructions, tree.size());
+    BOOST_CHECK_EQUAL(build.allocations, 1);
+    BOOST_CHECK_EQUAL(validation.proof_validations, 1);
+    BOOST_CHECK_EQUAL(validation.hash_invocations, tree.row_count());
+    BOOST_CHECK_EQUAL(validation.accumulator_constructions, tree.row_count());
+#else
+    BOOST_CHECK_EQUAL(build.hash_invocations, 0);
+    BOOST_CHECK_EQUAL(build.tree_builds, 0);
+    BOOST_CHECK_EQUAL(validation.proof_validations, 0);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_allocator_test) {
+    testing_allocator_template<hashes::sha2<256>, 2>(64);
+    testing_allocator_template<hashes::sha2<256>, 3>(27);
+    testing_allocator_template<hashes::blake2b<224>, 4>(64);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_serialization_test) {
+    testing_serialization_template<hashes::sha2<256>, 2>(64);
+    testing_serialization_template<hashes::sha2<256>, 3>(81);
+    testing_serialization_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_async_test) {
+    testing_async_template<hashes::sha2<256>, 2>(64);
+    testing_async_template<hashes::sha2<256>, 3>(81);
+    testing_async_template<hashes::blake2b<224>, 4>(256);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_distributed_test) {
+    testing_distributed_template<hashes::sha2<256>, 2>(4, 16);
+    testing_distributed_template<hashes::sha2<256>, 2>(1, 8);
+    testing_distributed_template<hashes::sha2<256>, 3>(9, 3);
+    testing_distributed_template<hashes::blake2b<224>, 4>(4, 1);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_poseidon_node_hash_test) {
+    // The field-native node hash must agree with the generic accumulator path.
+    std::vector<poseidon_type::digest_type> children;
+    for (std::size_t i = 0; i < 9; ++i) {
+        children.emplace_back(algebra::random_element<field_type>());
+    }
+    for (std::size_t arity = 1; arity <= children.size(); ++arity) {
+        BOOST_CHECK(containers::detail::generate_hash<poseidon_type>(children.begin(), children.begin() + arity) ==
+                    poseidon_accumulator_node(children.begin(), children.begin() + arity));
+    }
+
+    testing_poseidon_tree_template<2>(16);
+    testing_poseidon_tree_template<3>(27);
+    testing_poseidon_tree_template<4>(16);
+}
+
+BOOST_AUTO_TEST_CASE(merkletree_path_iterator_test) {
+    testing_path_iterator_template<hashes::sha2<256>, 2>(64);
+    testing_path_iterator_template<hashes::sha2<256>, 3>(81);
+    testing_path_iterator_template<hashes::blake2b<224>, 4>(256);
+    testing_path_iterator_template<hashes::sha2<256>, 5>(25);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,337 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+// Upper bounds on peak heap usage, heap allocations and hash invocations of the hot paths at
+// fixed sizes. Built with CRYPTO3_CONTAINERS_INSTRUMENTATION; the heap is measured by the
+// replaced global operator new below.
+
+#define BOOST_TEST_MODULE containers_perf_regression_test
+
+#include <nil/crypto3/algebra/curves/pallas.hpp>
+#include <nil/crypto3/algebra/random_element.hpp>
+#include <nil/crypto3/hash/sha2.hpp>
+
+#include <nil/crypto3/container/merkle/tree.hpp>
+#include <nil/crypto3/container/merkle/proof.hpp>
+#include <nil/crypto3/container/merkle/proof_batch.hpp>
+#include <nil/crypto3/container/sparse_vector.hpp>
+#include <nil/crypto3/container/detail/instrumentation.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<valgrind/valgrind.h>)
+#include <valgrind/valgrind.h>
+#endif
+#endif
+
+#ifndef RUNNING_ON_VALGRIND
+#define RUNNING_ON_VALGRIND 0
+#endif
+
+using namespace nil::crypto3;
+using namespace nil::crypto3::containers;
+
+namespace {
+    // Every block carries its size in front of it, so that frees can be accounted as well.
+    constexpr const std::size_t heap_header_size = alignof(std::max_align_t);
+
+    struct heap_state {
+        std::atomic<std::size_t> allocations;
+        std::atomic<std::size_t> live;
+        std::atomic<std::size_t> peak;
+    };
+
+    heap_state &heap() {
+        static heap_state state {};
+        return state;
+    }
+
+    // Heap use since construction: allocations made and peak bytes above the starting level.
+    class heap_scope {
+    public:
+        heap_scope() : _allocations(heap().allocations.load()), _live(heap().live.load()) {
+            heap().peak.store(_live);
+        }
+
+        std::size_t allocations() const {
+            return heap().allocations.load() - _allocations;
+        }
+
+        std::size_t peak_bytes() const {
+            return heap().peak.load() - _live;
+        }
+
+    private:
+        std::size_t _allocations;
+        std::size_t _live;
+    };
+
+    // Valgrind replaces operator new itself, the heap counters then stay at zero.
+    bool heap_measured() {
+        return !RUNNING_ON_VALGRIND;
+    }
+
+    struct instrumentation_scope {
+        instrumentation_scope() {
+            reset_instrumentation();
+        }
+
+        instrumentation_counters counters() const {
+            return instrumentation_snapshot();
+        }
+    };
+}    // namespace
+
+void *operator new(std::size_t n) {
+    void *block = std::malloc(n + heap_header_size);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<std::size_t *>(block) = n;
+    heap_state &state = heap();
+    state.allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t live = state.live.fetch_add(n, std::memory_order_relaxed) + n;
+    std::size_t peak = state.peak.load(std::memory_order_relaxed);
+    while (live > peak && !state.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return static_cast<char *>(block) + heap_header_size;
+}
+
+void operator delete(void *p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    void *block = reinterpret_cast<void *>(reinterpret_cast<std::uintptr_t>(p) - heap_header_size);
+    heap().live.fetch_sub(*static_cast<std::size_t *>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+using hash_type = hashes::sha2<256>;
+using tree_type = merkle_tree<hash_type, 2>;
+using proof_type = merkle_proof<hash_type, 2>;
+using value_type = typename tree_type::value_type;
+
+constexpr static const std::size_t leaf_number = 1 << 12;
+// Allowance for the small bookkeeping (index vectors, scratch rows) next to the payload.
+constexpr static const std::size_t heap_slack = 4096;
+
+// Heap allocations the hash itself makes for one leaf or one node, the build pays them once per hash.
+std::size_t hash_allocations(const std::array<std::uint8_t, 1> &leaf) {
+    heap_scope leaf_heap;
+    const value_type digest = nil::crypto3::hash<hash_type>(leaf);
+    const std::size_t leaf_allocations = leaf_heap.allocations();
+
+    const std::array<value_type, 2> children = {digest, digest};
+    heap_scope node_heap;
+    containers::detail::generate_hash<hash_type>(children.begin(), children.end());
+    return std::max(leaf_allocations, node_heap.allocations());
+}
+
+std::vector<std::array<std::uint8_t, 1>> perf_leaves() {
+    std::vector<std::array<std::uint8_t, 1>> leaves(leaf_number);
+    for (std::size_t i = 0; i < leaf_number; ++i) {
+        leaves[i][0] = static_cast<std::uint8_t>(i * 31 + 7);
+    }
+    return leaves;
+}
+
+BOOST_AUTO_TEST_SUITE(containers_perf_regression_test)
+
+BOOST_AUTO_TEST_CASE(merkletree_build_regression_test) {
+    const auto leaves = perf_leaves();
+    const std::size_t per_hash_allocations = hash_allocations(leaves.front());
+
+    instrumentation_scope counters;
+    heap_scope build_heap;
+    tree_type tree = make_merkle_tree<hash_type, 2>(leaves.begin(), leaves.end());
+    const instrumentation_counters build = counters.counters();
+
+    const std::size_t tree_bytes = tree.size() * sizeof(value_type);
+    BOOST_CHECK_EQUAL(build.hash_invocations, tree.size());
+    BOOST_CHECK_LE(build.accumulator_constructions, tree.size());
+    BOOST_CHECK_EQUAL(build.tree_builds, 1);
+    BOOST_CHECK_LE(build.allocations, tree.row_count());
+    if (heap_measured()) {
+        // Node storage is reserved once, scratch rows grow at most once per row.
+        BOOST_CHECK_LE(build_heap.allocations(), 1 + tree.row_count() + tree.size() * per_hash_allocations);
+        // Never a second copy of the nodes, whatever the hash itself allocates on the way.
+        BOOST_CHECK_LE(build_heap.peak_bytes(), tree_bytes + heap_slack);
+    }
+
+    // Moving the tree hands the storage over.
+    heap_scope move_heap;
+    tree_type moved(std::move(tree));
+    tree_type assigned;
+    assigned = std::move(moved);
+    if (heap_measured()) {
+        BOOST_CHECK_EQUAL(move_heap.peak_bytes(), 0);
+        BOOST_CHECK_EQUAL(move_heap.allocations(), 0);
+    }
+    BOOST_CHECK_EQUAL(assigned.size(), containers::detail::merkle_tree_length(leaf_number, 2));
+}
+
+BOOST_AUTO_TEST_CASE(merkleproof_generation_regression_test) {
+    const auto leaves = perf_leaves();
+    tree_type tree = make_merkle_tree<hash_type, 2>(leaves.begin(), leaves.end());
+    const std::size_t path_bytes = (tree.row_count() - 1) * sizeof(typename proof_type::layer_type);
+
+    instrumentation_scope counters;
+    heap_scope proof_heap;
+    std::vector<proof_type> proofs;
+    proofs.reserve(64);
+    for (std::size_t i = 0; i < 64; ++i) {
+        proofs.emplace_back(tree, i * (leaf_number / 64));
+    }
+    BOOST_CHECK_EQUAL(counters.counters().hash_invocations, 0);
+    if (heap_measured()) {
+        // The proof vector, then one path per proof.
+        BOOST_CHECK_LE(proof_heap.allocations(), 1 + 64);
+        BOOST_CHECK_LE(proof_heap.peak_bytes(), 64 * (sizeof(proof_type) + path_bytes) + heap_slack);
+    }
+
+    std::vector<std::size_t> idxs;
+    for (std::size_t i = 0; i < 64; ++i) {
+        idxs.emplace_back(i * (leaf_number / 64));
+    }
+    heap_scope batch_heap;
+    merkle_proof_batch<hash_type, 2> batch = generate_proofs(tree, idxs);
+    BOOST_CHECK_EQUAL(counters.counters().hash_invocations, 0);
+    if (heap_measured()) {
+        // Leaf indices, the layer arena and the path iterators.
+        BOOST_CHECK_LE(batch_heap.allocations(), 3);
+        BOOST_CHECK_LE(batch_heap.peak_bytes(), 64 * (sizeof(std::size_t) + path_bytes) + heap_slack);
+    }
+
+    heap_scope validation_heap;
+    for (std::size_t i = 0; i < proofs.size(); ++i) {
+        BOOST_CHECK(proofs[i].validate(leaves[idxs[i]]));
+    }
+    const instrumentation_counters validation = counters.counters();
+    BOOST_CHECK_EQUAL(validation.proof_validations, proofs.size());
+    BOOST_CHECK_EQUAL(validation.hash_invocations, proofs.size() * tree.row_count());
+    if (heap_measured()) {
+        BOOST_CHECK_LE(validation_heap.peak_bytes(), heap_slack);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(merkleproof_compressed_regression_test) {
+    const auto leaves = perf_leaves();
+    tree_type tree = make_merkle_tree<hash_type, 2>(leaves.begin(), leaves.end());
+
+    // 256 adjacent leaves: every proof but the first stops as soon as it meets a known node.
+    std::vector<std::size_t> idxs;
+    std::vector<std::array<std::uint8_t, 1>> proven;
+    for (std::size_t i = 0; i < 256; ++i) {
+        idxs.emplace_back(1024 + i);
+        proven.emplace_back(leaves[1024 + i]);
+    }
+
+    instrumentation_scope counters;
+    heap_scope compress_heap;
+    std::vector<proof_type> proofs = proof_type::generate_compressed_proofs(tree, idxs);
+    BOOST_CHECK_EQUAL(counters.counters().hash_invocations, 0);
+
+    std::size_t layers = 0;
+    for (const proof_type &proof : proofs) {
+        layers += proof.path().size();
+    }
+    // A full path for the first proof, then three layers per proof on average: the path of a
+    // leaf stops one row above the first sibling already sent.
+    BOOST_CHECK_LE(layers, tree.row_count() + 3 * idxs.size());
+    if (heap_measured()) {
+        // One exact path per proof, plus a scratch path, the index vectors and the known-node
+        // bitmap.
+        const std::size_t layer_size = sizeof(typename proof_type::layer_type);
+        BOOST_CHECK_LE(compress_heap.allocations(), idxs.size() + 8);
+        BOOST_CHECK_LE(compress_heap.peak_bytes(), idxs.size() * (sizeof(proof_type) + 2 * sizeof(std::size_t)) +
+                                                       (layers + tree.row_count()) * layer_size + tree.size() / 8 +
+                                                       heap_slack);
+    }
+
+    BOOST_CHECK(proof_type::validate_compressed_proofs(proofs, proven));
+    BOOST_CHECK_LE(counters.counters().hash_invocations, idxs.size() + layers);
+}
+
+BOOST_AUTO_TEST_CASE(sparse_vector_accumulation_regression_test) {
+    using curve_type = algebra::curves::pallas;
+    using group_type = typename curve_type::template g1_type<>;
+    using scalar_field_type = typename curve_type::scalar_field_type;
+    using group_value_type = typename group_type::value_type;
+    using method_type = algebra::policies::multiexp_method_naive_plain;
+
+    constexpr const std::size_t size = 1 << 10;
+    std::vector<group_value_type> bases(size);
+    std::vector<typename scalar_field_type::value_type> scalars(size / 2);
+    for (std::size_t i = 0; i < size; ++i) {
+        bases[i] = algebra::random_element<group_type>();
+    }
+    for (std::size_t i = 0; i < size / 2; ++i) {
+        scalars[i] = algebra::random_element<scalar_field_type>();
+    }
+    const container::sparse_vector<group_type> v(std::move(bases));
+
+    // Half of the entries are accumulated, the other half is copied into the result once.
+    instrumentation_scope counters;
+    heap_scope insert_heap;
+    auto result = v.insert<method_type>(size / 4, scalars.cbegin(), scalars.cend());
+    const instrumentation_counters insert = counters.counters();
+    BOOST_CHECK_EQUAL(result.second.size(), size / 2);
+    BOOST_CHECK_EQUAL(insert.sparse_vector_inserts, 1);
+    BOOST_CHECK_EQUAL(insert.allocations, 2);
+    if (heap_measured()) {
+        // The indices and values kept, the multiexp pieces and their partial sums.
+        BOOST_CHECK_LE(insert_heap.allocations(), 4);
+        BOOST_CHECK_LE(insert_heap.peak_bytes(),
+                       (size / 2) * (sizeof(std::size_t) + sizeof(group_value_type)) + heap_slack);
+    }
+
+    // A window over the whole vector keeps nothing.
+    std::vector<typename scalar_field_type::value_type> all_scalars(size, scalars.front());
+    instrumentation_scope whole_counters;
+    heap_scope whole_heap;
+    auto whole = v.insert<method_type>(0, all_scalars.cbegin(), all_scalars.cend());
+    BOOST_CHECK(whole.second.empty());
+    BOOST_CHECK_EQUAL(whole_counters.counters().allocations, 0);
+    if (heap_measured()) {
+        // Only the multiexp pieces and their partial sums.
+        BOOST_CHECK_LE(whole_heap.allocations(), 2);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,308 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2018-2020 Mikhail Komarov <nemo@nil.foundation>
+// Copyright (c) 2021-2022 Aleksei Moskvin <alalmoskvin@gmail.com>
+//
+// MIT License
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//---------------------------------------------------------------------------//
+
+#define BOOST_TEST_MODULE containter_sparse_vector_test
+
+#include <nil/crypto3/algebra/curves/pallas.hpp>
+#include <nil/crypto3/algebra/random_element.hpp>
+
+#include <nil/crypto3/container/sparse_vector.hpp>
+#include <nil/crypto3/container/accumulation_vector.hpp>
+#include <nil/crypto3/container/compressed_sparse_vector.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace nil::crypto3;
+
+using curve_type = algebra::curves::pallas;
+using group_type = typename curve_type::template g1_type<>;
+using scalar_field_type = typename curve_type::scalar_field_type;
+using group_value_type = typename group_type::value_type;
+using scalar_value_type = typename scalar_field_type::value_type;
+using sparse_vector_type = container::sparse_vector<group_type>;
+using accumulation_vector_type = container::accumulation_vector<group_type>;
+using compressed_vector_type = container::compressed_sparse_vector<group_type>;
+
+constexpr static const std::size_t domain_size = 64;
+
+// Every index but those equal to 2 mod 5 and those in [20, 26): runs of one, two and four
+// entries separated by gaps.
+sparse_vector_type gapped_sparse_vector() {
+    sparse_vector_type v;
+    v.domain_size_ = domain_size;
+    for (std::size_t i = 0; i < domain_size; ++i) {
+        if (i % 5 != 2 && (i < 20 || i >= 26)) {
+            v.indices.emplace_back(i);
+            v.values.emplace_back(algebra::random_element<group_type>());
+        }
+    }
+    return v;
+}
+
+std::vector<scalar_value_type> random_scalars(std::size_t n) {
+    std::vector<scalar_value_type> scalars(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        scalars[i] = algebra::random_element<scalar_field_type>();
+    }
+    return scalars;
+}
+
+// Checks v.insert against the sum of scalar * base over the entries of v in the window
+// [offset, offset + len), and that exactly the entries outside of it are kept.
+template<typename MultiexpMethod>
+void check_insert(const sparse_vector_type &v, std::size_t offset, std::size_t len, std::size_t threads) {
+    const std::vector<scalar_value_type> scalars = random_scalars(len);
+    const auto result = v.insert<MultiexpMethod>(offset, scalars.cbegin(), scalars.cend(), threads);
+
+    group_value_type expected = group_value_type::zero();
+    std::vector<std::size_t> kept_indices;
+    std::vector<group_value_type> kept_values;
+    for (std::size_t i = 0; i < v.size(); ++i) {
+        if (v.indices[i] >= offset && v.indices[i] < offset + len) {
+            expected = expected + v.values[i] * scalars[v.indices[i] - offset];
+        } else {
+            kept_indices.emplace_back(v.indices[i]);
+            kept_values.emplace_back(v.values[i]);
+        }
+    }
+
+    BOOST_CHECK(result.first == expected);
+    BOOST_CHECK(result.second.indices == kept_indices);
+    BOOST_CHECK(result.second.values == kept_values);
+    BOOST_CHECK_EQUAL(result.second.domain_size(), v.domain_size());
+}
+
+template<typename MultiexpMethod>
+void check_insert_windows(const sparse_vector_type &v, std::size_t threads) {
+    // the whole domain
+    check_insert<MultiexpMethod>(v, 0, domain_size, threads);
+    // starting mid-vector, over runs and gaps
+    check_insert<MultiexpMethod>(v, 9, 30, threads);
+    // the tail, from inside a run
+    check_insert<MultiexpMethod>(v, 45, domain_size - 45, threads);
+    // a single entry
+    check_insert<MultiexpMethod>(v, 13, 1, threads);
+    // covering nothing: within a gap, and an empty window
+    check_insert<MultiexpMethod>(v, 20, 6, threads);
+    check_insert<MultiexpMethod>(v, 7, 1, threads);
+    check_insert<MultiexpMethod>(v, 30, 0, threads);
+}
+
+// Checks the compressed insert and insert_inplace of 'v' against sparse_vector::insert.
+void check_compressed_insert(const sparse_vector_type &v, std::size_t offset, std::size_t len, std::size_t threads) {
+    const std::vector<scalar_value_type> scalars = random_scalars(len);
+    const auto expected = v.insert(offset, scalars.cbegin(), scalars.cend(), threads);
+
+    const compressed_vector_type c(v);
+    const auto result = c.insert(offset, scalars.cbegin(), scalars.cend(), threads);
+    BOOST_CHECK(result.first == expected.first);
+    BOOST_CHECK(result.second.is_valid());
+    BOOST_CHECK(result.second == compressed_vector_type(expected.second));
+    BOOST_CHECK(result.second.decompress().indices == expected.second.indices);
+
+    compressed_vector_type inplace(v);
+    BOOST_CHECK(inplace.insert_inplace(offset, scalars.cbegin(), scalars.cend(), threads) == expected.first);
+    BOOST_CHECK(inplace.is_valid());
+    BOOST_CHECK(inplace == result.second);
+}
+
+// Chunks [offset, offset + len) streamed over gapped_sparse_vector(): an empty one, one within
+// the gap [20, 26), one across it, then the rest.
+const std::vector<std::pair<std::size_t, std::size_t>> &stream_chunks() {
+    static const std::vector<std::pair<std::size_t, std::size_t>> chunks = {
+        {0, 9}, {9, 0}, {20, 6}, {9, 24}, {33, 1}, {34, domain_size - 34}};
+    return chunks;
+}
+
+BOOST_AUTO_TEST_SUITE(containers_sparse_vector_test)
+
+BOOST_AUTO_TEST_CASE(sparse_vector_insert_test) {
+    const sparse_vector_type v = gapped_sparse_vector();
+
+    for (std::size_t threads : {1, 4}) {
+        check_insert_windows<algebra::policies::multiexp_method_bos_coster>(v, threads);
+        // runs (or pieces of them) of one or two terms go through the naive method, longer ones
+        // through Bos-Coster
+        check_insert_windows<container::multiexp_method_by_size<algebra::policies::multiexp_method_naive_plain,
+                                                                algebra::policies::multiexp_method_bos_coster, 3>>(
+            v, threads);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sparse_vector_insert_dense_test) {
+    using method_type = container::multiexp_method_by_size<algebra::policies::multiexp_method_naive_plain,
+                                                           algebra::policies::multiexp_method_bos_coster, 32>;
+
+    std::vector<group_value_type> bases(domain_size);
+    for (std::size_t i = 0; i < domain_size; ++i) {
+        bases[i] = algebra::random_element<group_type>();
+    }
+    const sparse_vector_type v(std::move(bases));
+
+    for (std::size_t threads : {1, 4}) {
+        check_insert<algebra::policies::multiexp_method_bos_coster>(v, 0, domain_size, threads);
+        check_insert<algebra::policies::multiexp_method_bos_coster>(v, 17, 20, threads);
+        // a single run, above the threshold with one thread, cut into pieces below it with four
+        check_insert<method_type>(v, 0, domain_size, threads);
+        // below the threshold whatever the thread count
+        check_insert<method_type>(v, 17, 5, threads);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sparse_vector_insert_inplace_test) {
+    const std::vector<scalar_value_type> scalars = random_scalars(domain_size);
+
+    for (std::size_t threads : {1, 4}) {
+        sparse_vector_type streamed = gapped_sparse_vector();
+        sparse_vector_type chained = streamed;
+        group_value_type streamed_sum = group_value_type::zero(), chained_sum = group_value_type::zero();
+
+        for (const auto &chunk : stream_chunks()) {
+            const auto first = scalars.cbegin() + chunk.first;
+            streamed_sum =
+                streamed_sum + streamed.insert_inplace(chunk.first, first, first + chunk.second, threads);
+            auto result = chained.insert(chunk.first, first, first + chunk.second, threads);
+            chained_sum = chained_sum + result.first;
+            chained = std::move(result.second);
+
+            BOOST_CHECK(streamed_sum == chained_sum);
+            BOOST_CHECK(streamed.indices == chained.indices);
+            BOOST_CHECK(streamed.values == chained.values);
+            BOOST_CHECK_EQUAL(streamed.domain_size(), chained.domain_size());
+        }
+        BOOST_CHECK(streamed.empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(accumulation_vector_accumulate_chunk_inplace_test) {
+    const std::vector<scalar_value_type> scalars = random_scalars(domain_size);
+
+    for (std::size_t threads : {1, 4}) {
+        accumulation_vector_type streamed(group_value_type::zero(), gapped_sparse_vector());
+        accumulation_vector_type chained = streamed;
+
+        for (const auto &chunk : stream_chunks()) {
+            const auto first = scalars.cbegin() + chunk.first;
+            streamed.accumulate_chunk_inplace(first, first + chunk.second, chunk.first, threads);
+            chained = chained.accumulate_chunk(first, first + chunk.second, chunk.first, threads);
+
+            BOOST_CHECK(streamed.first == chained.first);
+            BOOST_CHECK(streamed.rest.indices == chained.rest.indices);
+            BOOST_CHECK(streamed.rest.values == chained.rest.values);
+        }
+        BOOST_CHECK(streamed.is_fully_accumulated());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compressed_sparse_vector_round_trip_test) {
+    std::vector<group_value_type> bases(domain_size);
+    for (std::size_t i = 0; i < domain_size; ++i) {
+        bases[i] = algebra::random_element<group_type>();
+    }
+    const sparse_vector_type gapped = gapped_sparse_vector();
+    const std::vector<scalar_value_type> scalars = random_scalars(6);
+    // first entry at index 6
+    const sparse_vector_type tail = gapped.insert(0, scalars.cbegin(), scalars.cend()).second;
+
+    const sparse_vector_type dense(std::move(bases));
+
+    for (const sparse_vector_type &v : {gapped, tail, dense, sparse_vector_type()}) {
+        const compressed_vector_type c(v);
+        BOOST_CHECK(c.is_valid());
+        BOOST_CHECK_EQUAL(c.size(), v.size());
+        BOOST_CHECK_EQUAL(c.domain_size(), v.domain_size());
+
+        const sparse_vector_type d = c.decompress();
+        BOOST_CHECK(d.indices == v.indices);
+        BOOST_CHECK(d.values == v.values);
+        BOOST_CHECK_EQUAL(d.domain_size(), v.domain_size());
+
+        // inside runs, in gaps and before the first run
+        for (std::size_t i = 0; i < v.domain_size(); ++i) {
+            BOOST_CHECK(c[i] == v[i]);
+        }
+
+        const std::size_t index_bits = sizeof(compressed_vector_type::index_type) * 8;
+        BOOST_CHECK_EQUAL(c.size_in_bits(), (2 * c.runs() + 1) * index_bits + v.size() * group_type::value_bits);
+        if (!v.empty()) {
+            BOOST_CHECK(c.size_in_bits() < v.size_in_bits());
+        }
+    }
+
+    const compressed_vector_type c(gapped);
+    // 0, 1 | 3 .. 6 | 8 .. 11 | 13 .. 16 | 18, 19 | 26 | 28 .. 31 | ... | 58 .. 61 | 63
+    BOOST_CHECK_EQUAL(c.runs(), 14);
+    BOOST_CHECK(c[26] == gapped.values[16]);
+    BOOST_CHECK(c[22] == group_value_type());
+    BOOST_CHECK(compressed_vector_type(tail)[3] == group_value_type());
+
+    compressed_vector_type overlapping = c;
+    overlapping.run_starts[1] = overlapping.run_starts[0] + 1;
+    BOOST_CHECK(!overlapping.is_valid());
+    compressed_vector_type past_domain = c;
+    past_domain.domain_size_ = 60;
+    BOOST_CHECK(!past_domain.is_valid());
+}
+
+BOOST_AUTO_TEST_CASE(compressed_sparse_vector_index_type_test) {
+    using byte_indexed_vector_type = container::compressed_sparse_vector<group_type, std::uint8_t>;
+
+    sparse_vector_type v;
+    v.domain_size_ = 256;
+    BOOST_CHECK_THROW(byte_indexed_vector_type(v).domain_size(), std::length_error);
+    v.domain_size_ = 255;
+    BOOST_CHECK_EQUAL(byte_indexed_vector_type(v).domain_size(), 255);
+}
+
+BOOST_AUTO_TEST_CASE(compressed_sparse_vector_insert_test) {
+    std::vector<group_value_type> bases(domain_size);
+    for (std::size_t i = 0; i < domain_size; ++i) {
+        bases[i] = algebra::random_element<group_type>();
+    }
+    const sparse_vector_type dense(std::move(bases));
+    const sparse_vector_type gapped = gapped_sparse_vector();
+
+    for (std::size_t threads : {1, 4}) {
+        // within a single run, cutting it in two
+        check_compressed_insert(dense, 10, 20, threads);
+        check_compressed_insert(gapped, 9, 2, threads);
+        // from the middle of one run to the middle of another one
+        check_compressed_insert(gapped, 4, 6, threads);
+        check_compressed_insert(gapped, 15, 14, threads);
+        // whole runs, everything and nothing
+        check_compressed_insert(gapped, 3, 9, threads);
+        check_compressed_insert(gapped, 0, domain_size, threads);
+        check_compressed_insert(gapped, 20, 6, threads);
+        check_compressed_insert(gapped, 30, 0, threads);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()